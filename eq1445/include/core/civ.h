@@ -0,0 +1,449 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "core/merge.h"
+#include "core/sort.h"
+#include "core/util.h"
+
+// ------------------ CIV: index vectors with two-run index trimming ------------------
+// Requires EquihashParams from the including translation unit (include the
+// variant's util header first).
+//
+// Items carry the index vector of their 2^i leaves instead of a pointer
+// into an IP layer, so no IP layer is kept and there is no backward pass.
+// Full vectors would make the deep layers the largest, so the first run
+// keeps only the low CIV_TRIM_BITS bits of every leaf index, bit-packed.
+// Its final items are candidate trimmed vectors. Every aligned 2^h-leaf
+// chunk of every candidate goes into check table h, and a single second
+// run with full indices drops each layer-h item whose trimmed vector is not
+// in table h. Both runs order each pair the same way (civ_swap), so a
+// chunk of the second run trims to exactly the string the first run
+// produced.
+
+#ifndef CIV_TRIM_BITS
+#define CIV_TRIM_BITS 1 // leaf index bits kept by the first CIV run
+#endif
+static_assert(CIV_TRIM_BITS >= 1 && CIV_TRIM_BITS <= 8, "CIV_TRIM_BITS must be between 1 and 8");
+
+// Layer i holds the N - i * ell bits that are not yet collided.
+inline constexpr size_t civ_xor_bytes(size_t i)
+{
+    return (EquihashParams::N - i * EquihashParams::kCollisionBitLength + 7) / 8;
+}
+
+template <size_t I>
+inline constexpr size_t kCivTrimBits = (size_t(1) << I) * CIV_TRIM_BITS; // bits of a layer-I trimmed vector
+
+template <size_t I>
+inline constexpr size_t kCivTrimBytes = (kCivTrimBits<I> + 7) / 8;
+
+// First run: trimmed vector, bit-packed, low bits first.
+template <size_t I>
+using CivItem = ItemValIdx<civ_xor_bytes(I), kCivTrimBytes<I>>;
+
+// Second run: full vector, kIndexBytes little-endian bytes per leaf.
+template <size_t I>
+using CivFullItem = ItemValIdx<civ_xor_bytes(I), (size_t(1) << I) * EquihashParams::kIndexBytes>;
+
+// ------------------ Bit-packed trimmed vectors ------------------
+// dst = bits [0, W) of x, then bits [0, W) of y. Padding bits stay zero so
+// packed vectors compare and hash bytewise.
+template <size_t W>
+inline void civ_concat_bits(uint8_t *dst, const uint8_t *x, const uint8_t *y)
+{
+    if constexpr (W % 8 == 0)
+    {
+        std::memcpy(dst, x, W / 8);
+        std::memcpy(dst + W / 8, y, W / 8);
+    }
+    else
+    {
+        std::memset(dst, 0, (2 * W + 7) / 8);
+        for (size_t b = 0; b < W; ++b)
+        {
+            dst[b / 8] |= static_cast<uint8_t>(((x[b / 8] >> (b % 8)) & 1u) << (b % 8));
+            const size_t o = W + b;
+            dst[o / 8] |= static_cast<uint8_t>(((y[b / 8] >> (b % 8)) & 1u) << (o % 8));
+        }
+    }
+}
+
+// Bits [first, first + len) of src, packed into dst from bit 0.
+inline void civ_extract_bits(uint8_t *dst, const uint8_t *src, size_t first, size_t len)
+{
+    std::memset(dst, 0, (len + 7) / 8);
+    for (size_t b = 0; b < len; ++b)
+    {
+        const size_t s = first + b;
+        dst[b / 8] |= static_cast<uint8_t>(((src[s / 8] >> (s % 8)) & 1u) << (b % 8));
+    }
+}
+
+// Trimmed vector of a full one (indices are little-endian, so the low byte
+// holds the kept bits).
+template <size_t I>
+inline void civ_trim(const CivFullItem<I> &item, uint8_t *out)
+{
+    constexpr size_t IB = EquihashParams::kIndexBytes;
+    constexpr unsigned mask = (1u << CIV_TRIM_BITS) - 1;
+    std::memset(out, 0, kCivTrimBytes<I>);
+    for (size_t j = 0; j < (size_t(1) << I); ++j)
+    {
+        const unsigned v = item.index[j * IB] & mask;
+        for (size_t t = 0; t < CIV_TRIM_BITS; ++t)
+        {
+            const size_t o = j * CIV_TRIM_BITS + t;
+            out[o / 8] |= static_cast<uint8_t>(((v >> t) & 1u) << (o % 8));
+        }
+    }
+}
+
+// ------------------ Check tables ------------------
+// A layer-h trimmed vector, zero-padded to whole bytes, is its own key.
+template <size_t H>
+using CivKey = std::array<uint8_t, kCivTrimBytes<H>>;
+
+struct CivKeyHash
+{
+    template <size_t B>
+    size_t operator()(const std::array<uint8_t, B> &key) const
+    {
+        uint64_t h = 0x9e3779b97f4a7c15ull ^ B;
+        for (size_t i = 0; i < B; i += 8)
+        {
+            uint64_t w = 0;
+            std::memcpy(&w, key.data() + i, std::min<size_t>(8, B - i));
+            h = (h ^ w) * 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+template <size_t H>
+using CivTable = std::unordered_set<CivKey<H>, CivKeyHash>;
+
+template <size_t... H>
+std::tuple<CivTable<H>...> civ_table_tuple(std::index_sequence<H...>);
+
+// table<h>(): the trimmed 2^h-leaf chunks of the current candidates.
+struct CivCheckTables
+{
+    decltype(civ_table_tuple(std::make_index_sequence<EquihashParams::K + 1>{})) tables;
+
+    template <size_t H>
+    CivTable<H> &table() { return std::get<H>(tables); }
+
+    void clear()
+    {
+        std::apply([](auto &...t) { (t.clear(), ...); }, tables);
+    }
+
+    void add_candidate(const uint8_t *cand)
+    {
+        add_chunks(cand, std::make_index_sequence<EquihashParams::K>{});
+    }
+
+private:
+    template <size_t... H>
+    void add_chunks(const uint8_t *cand, std::index_sequence<H...>)
+    {
+        (add_chunks_of<H + 1>(cand), ...);
+    }
+
+    template <size_t H>
+    void add_chunks_of(const uint8_t *cand)
+    {
+        constexpr size_t len = (size_t(1) << H) * CIV_TRIM_BITS;
+        for (size_t c = 0; c < (size_t(1) << (EquihashParams::K - H)); ++c)
+        {
+            CivKey<H> chunk;
+            civ_extract_bits(chunk.data(), cand, c * len, len);
+            table<H>().insert(chunk);
+        }
+    }
+};
+
+// The keep filter of merge_inplace_generic is a plain function pointer, so
+// the tables of the run in progress live here, next to the count of merged
+// items the filter let through (what the layer would hold with room enough).
+inline CivCheckTables &civ_check_tables()
+{
+    static CivCheckTables tables;
+    return tables;
+}
+
+inline uint64_t &civ_kept()
+{
+    static uint64_t kept = 0;
+    return kept;
+}
+
+template <size_t I>
+inline bool civ_keep(const CivFullItem<I> &item)
+{
+    CivKey<I> t;
+    civ_trim<I>(item, t.data());
+    const bool keep = civ_check_tables().table<I>().count(t) != 0;
+    civ_kept() += keep;
+    return keep;
+}
+
+// ------------------ Merge helpers ------------------
+// Step I merges layer I into I+1; the last step (I = K-1) collides on all
+// 2*ell remaining bits.
+template <size_t I>
+struct CivStep
+{
+    static constexpr bool kLast = I + 1 == EquihashParams::K;
+    static constexpr size_t kKeyBits = (kLast ? 2 : 1) * EquihashParams::kCollisionBitLength;
+    using Key = std::conditional_t<(kKeyBits <= 32), uint32_t, uint64_t>;
+};
+
+template <typename Item, size_t I>
+inline typename CivStep<I>::Key civ_key(const Item &item)
+{
+    return get_key_bits<Item, CivStep<I>::kKeyBits>(item);
+}
+
+template <typename Item, size_t I>
+inline void civ_sort(LayerVec<Item> &layer)
+{
+    sort_layer_by_key<Item, CivStep<I>::kKeyBits>(layer);
+}
+
+// Pair order, identical in both runs: by the uncollided XOR bits, which
+// do not depend on the indices, then (in the final step, where all bits
+// collide) by trimmed vector.
+inline bool civ_swap(const uint8_t *xa, const uint8_t *xb, size_t xor_bytes,
+                     const uint8_t *ta, const uint8_t *tb, size_t trim_bytes)
+{
+    const int c = std::memcmp(xa, xb, xor_bytes);
+    return c > 0 || (c == 0 && std::memcmp(tb, ta, trim_bytes) < 0);
+}
+
+template <size_t I>
+inline CivItem<I + 1> civ_merge_item(const CivItem<I> &a, const CivItem<I> &b)
+{
+    auto out = merge_item_generic<CivItem<I>, CivItem<I + 1>>(
+        a, b, static_cast<int>(EquihashParams::kCollisionBitLength));
+    const bool swap = civ_swap(a.XOR, b.XOR, sizeof(a.XOR), a.index, b.index, sizeof(a.index));
+    civ_concat_bits<kCivTrimBits<I>>(out.index, swap ? b.index : a.index, swap ? a.index : b.index);
+    return out;
+}
+
+template <size_t I>
+inline CivFullItem<I + 1> civ_full_merge_item(const CivFullItem<I> &a, const CivFullItem<I> &b)
+{
+    auto out = merge_item_generic<CivFullItem<I>, CivFullItem<I + 1>>(
+        a, b, static_cast<int>(EquihashParams::kCollisionBitLength));
+    uint8_t ta[kCivTrimBytes<I>], tb[kCivTrimBytes<I>];
+    civ_trim<I>(a, ta);
+    civ_trim<I>(b, tb);
+    const bool swap = civ_swap(a.XOR, b.XOR, sizeof(a.XOR), ta, tb, sizeof(ta));
+    std::memcpy(out.index, (swap ? b : a).index, sizeof(a.index));
+    std::memcpy(out.index + sizeof(a.index), (swap ? a : b).index, sizeof(b.index));
+    return out;
+}
+
+// The two runs differ only in item type, merge and filter.
+struct CivTrimmedRun
+{
+    template <size_t I>
+    using Item = CivItem<I>;
+    static constexpr bool kFiltered = false;
+
+    template <size_t I>
+    static Item<I + 1> merge(const Item<I> &a, const Item<I> &b) { return civ_merge_item<I>(a, b); }
+    template <size_t I>
+    static bool keep(const Item<I> &)
+    {
+        ++civ_kept();
+        return true;
+    }
+};
+
+struct CivFullRun
+{
+    template <size_t I>
+    using Item = CivFullItem<I>;
+    static constexpr bool kFiltered = true;
+
+    template <size_t I>
+    static Item<I + 1> merge(const Item<I> &a, const Item<I> &b) { return civ_full_merge_item<I>(a, b); }
+    template <size_t I>
+    static bool keep(const Item<I> &item) { return civ_keep<I>(item); }
+};
+
+// Merge layer I into I+1 in place at `base`. Items grow once the index
+// vector outweighs the collided XOR bytes; the layer is then moved to the
+// end of the arena first, and the gap in front of it is head room for the
+// output.
+template <typename Run, size_t I>
+inline LayerVec<typename Run::template Item<I + 1>>
+civ_step(LayerVec<typename Run::template Item<I>> &src, uint8_t *base, size_t arena_bytes, uint64_t &dropped)
+{
+    using Src = typename Run::template Item<I>;
+    using Dst = typename Run::template Item<I + 1>;
+    using Step = CivStep<I>;
+
+    const size_t n = src.size();
+    uint8_t *at = base;
+    if constexpr (sizeof(Dst) > sizeof(Src))
+    {
+        at = base + arena_bytes - n * sizeof(Src);
+        std::memmove(at, base, n * sizeof(Src));
+    }
+    auto moved = init_layer<Src>(at, n * sizeof(Src));
+    moved.resize(n);
+
+    auto dst = init_layer<Dst>(base, arena_bytes);
+    constexpr bool (*is_zero)(const Dst &) =
+        Step::kLast ? static_cast<bool (*)(const Dst &)>(nullptr) : &is_zero_item<Dst>;
+    civ_kept() = 0;
+    merge_inplace_generic<Src, Dst, &Run::template merge<I>, &civ_sort<Src, I>, !Step::kLast,
+                          typename Step::Key, &civ_key<Src, I>, is_zero, Step::kLast, &Run::template keep<I + 1>>(
+        moved, dst, static_cast<size_t>(at - base));
+    dropped += civ_kept() - dst.size();
+    if (g_verbose)
+    {
+        std::cout << "Layer " << I + 1 << " size: " << dst.size() << std::endl;
+    }
+    return dst;
+}
+
+template <typename Run, size_t I>
+inline LayerVec<typename Run::template Item<EquihashParams::K>>
+civ_forward(LayerVec<typename Run::template Item<I>> &layer, uint8_t *base, size_t arena_bytes, uint64_t &dropped)
+{
+    auto next = civ_step<Run, I>(layer, base, arena_bytes, dropped);
+    if constexpr (I + 1 == EquihashParams::K)
+        return next;
+    else
+        return civ_forward<Run, I + 1>(next, base, arena_bytes, dropped);
+}
+
+// Layer 0 of either run: the leaf XORs with the (trimmed) leaf index.
+template <typename Run>
+inline LayerVec<typename Run::template Item<0>> civ_fill_layer0(int seed, uint8_t *base, size_t arena_bytes)
+{
+    using Item = typename Run::template Item<0>;
+    const size_t mask = Run::kFiltered ? ~size_t(0) : (size_t(1) << CIV_TRIM_BITS) - 1;
+    auto L = init_layer<Item>(base, arena_bytes);
+    for_each_leaf(seed, [&](size_t leaf, const uint8_t *x)
+                  {
+                      Item item;
+                      std::memcpy(item.XOR, x, sizeof(item.XOR));
+                      set_index(item, leaf & mask);
+                      L.push_back(item); });
+    return L;
+}
+
+// ------------------ Memory ------------------
+// Both runs merge in one arena. The first run's lists stay near
+// kMaxListSize below layer K, whose few candidates need no budget. In the
+// second, a layer-h item survives the filter with probability about
+// (candidates * 2^(K-h) chunks) / 2^(2^h * T) trimmed vectors, so only the
+// low layers are full; the arena is sized for kCivCandidateBudget
+// candidates, and a merge that runs out of room drops its overflow (counted
+// and reported by civ_solve).
+inline constexpr double kCivCandidateBudget = 16.0;
+
+template <size_t I>
+inline constexpr double civ_full_layer_fraction()
+{
+    constexpr size_t kExp = (size_t(1) << I) * CIV_TRIM_BITS;
+    if constexpr (kExp >= 63)
+        return 0.0;
+    else
+        return std::min(1.0, kCivCandidateBudget * static_cast<double>(size_t(1) << (EquihashParams::K - I)) /
+                                 static_cast<double>(size_t(1) << kExp));
+}
+
+template <size_t... I>
+inline double civ_slot_bytes(std::index_sequence<I...>)
+{
+    double bytes = 0.0;
+    ((bytes = std::max({bytes, static_cast<double>(sizeof(CivItem<I>)),
+                        civ_full_layer_fraction<I>() * sizeof(CivFullItem<I>)})),
+     ...);
+    return bytes;
+}
+
+inline uint64_t civ_arena_bytes()
+{
+    const double slot = civ_slot_bytes(std::make_index_sequence<EquihashParams::K>{});
+    return static_cast<uint64_t>(slot * static_cast<double>(EquihashParams::kMaxListSize)) + 64;
+}
+
+// ------------------ Solver ------------------
+// `dropped` receives the merged items (of either run) that did not fit the
+// arena; the second run overflows when there are more candidates than
+// kCivCandidateBudget and they happen to need the room.
+inline SolutionSet civ_solve(int seed, uint8_t *base, size_t arena_bytes, uint64_t *dropped = nullptr)
+{
+    constexpr size_t K = EquihashParams::K;
+    constexpr size_t IB = EquihashParams::kIndexBytes;
+
+    uint64_t lost = 0;
+    auto L0 = civ_fill_layer0<CivTrimmedRun>(seed, base, arena_bytes);
+    auto cands = civ_forward<CivTrimmedRun, 0>(L0, base, arena_bytes, lost);
+
+    CivCheckTables &tables = civ_check_tables();
+    tables.clear();
+    CivTable<K> distinct;
+    for (const auto &c : cands)
+    {
+        CivKey<K> key;
+        std::memcpy(key.data(), c.index, key.size());
+        if (distinct.insert(key).second)
+            tables.add_candidate(c.index);
+    }
+    if (g_verbose)
+    {
+        std::cout << "Second run with trimmed index bit length " << CIV_TRIM_BITS << " for "
+                  << distinct.size() << " candidate(s)" << std::endl;
+    }
+
+    SolutionSet solutions;
+    if (!distinct.empty())
+    {
+        auto F0 = civ_fill_layer0<CivFullRun>(seed, base, arena_bytes);
+        auto found = civ_forward<CivFullRun, 0>(F0, base, arena_bytes, lost);
+        tables.clear();
+
+        std::vector<uint32_t> sol(size_t(1) << K);
+        for (const auto &f : found)
+        {
+            for (size_t j = 0; j < sol.size(); ++j)
+            {
+                uint32_t v = 0;
+                for (size_t t = 0; t < IB; ++t)
+                    v |= static_cast<uint32_t>(f.index[j * IB + t]) << (8 * t);
+                sol[j] = v;
+            }
+            solutions.push_full(sol.data());
+        }
+        solutions.drop_trivial();
+    }
+
+    if (lost)
+    {
+        std::cerr << "Warning: civ dropped " << lost << " items beyond the arena ("
+                  << distinct.size() << " candidate(s), budget " << kCivCandidateBudget << ")" << std::endl;
+    }
+    if (dropped)
+        *dropped = lost;
+    return solutions;
+}
@@ -0,0 +1,1014 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "core/equihash_base.h"
+#include "core/ip_codec.h"
+
+// External-memory (EM) tuning knobs
+#ifndef EM_STAGING_BATCH
+#define EM_STAGING_BATCH 65536 // number of IP items per staging buffer handed to the writer thread
+#endif
+
+#ifndef EM_STAGING_BUFFERS
+#define EM_STAGING_BUFFERS 2 // number of staging buffers, >= 2 so merging overlaps with the previous write
+#endif
+
+#ifndef EM_BLOCK_ITEMS
+#define EM_BLOCK_ITEMS 4096 // IP items per compressed block (unit of random access on disk)
+#endif
+
+#ifndef EM_GATHER_GAP_BYTES
+#define EM_GATHER_GAP_BYTES 65536 // holes up to this size are read through instead of seeking over them
+#endif
+
+#ifndef EM_GATHER_EXTENT_BYTES
+#define EM_GATHER_EXTENT_BYTES (1 << 20) // maximum size of one coalesced read during EM expansion
+#endif
+
+#ifndef EM_DIRECT_ALIGN
+#define EM_DIRECT_ALIGN 4096 // O_DIRECT buffer/offset/length alignment (logical block size upper bound)
+#endif
+
+#ifndef EM_DIRECT_CHUNK
+#define EM_DIRECT_CHUNK (1 << 20) // bytes per aligned O_DIRECT transfer (writer tail buffer, reader bounce buffer)
+#endif
+
+static_assert(EM_STAGING_BUFFERS >= 1, "EM_STAGING_BUFFERS must be at least 1");
+static_assert((EM_DIRECT_ALIGN & (EM_DIRECT_ALIGN - 1)) == 0, "EM_DIRECT_ALIGN must be a power of two");
+static_assert(EM_DIRECT_CHUNK % EM_DIRECT_ALIGN == 0, "EM_DIRECT_CHUNK must be a multiple of EM_DIRECT_ALIGN");
+
+// On-disk layout of IP layers
+enum class IPDiskFormat
+{
+    RAW,    // plain ItemIP records
+    PACKED  // IPBlockCodec blocks of EM_BLOCK_ITEMS items + IPBlockIndex
+};
+
+// Staging buffers used for `stripes` files: a striped store keeps one batch
+// in flight per stripe while the merge fills another.
+inline constexpr std::size_t em_staging_slots(std::size_t stripes = 1)
+{
+    return stripes > 1 ? std::max<std::size_t>(EM_STAGING_BUFFERS, stripes + 1)
+                       : static_cast<std::size_t>(EM_STAGING_BUFFERS);
+}
+
+// Bytes of arena the drivers must reserve for the writer's staging buffers
+// (plus one block of encoder output per stripe). With `direct_io` the buffers
+// are aligned inside the region and one aligned O_DIRECT chunk is added per
+// stripe.
+template <typename IPItem>
+inline constexpr std::size_t em_staging_bytes(bool direct_io = false, std::size_t stripes = 1)
+{
+    return em_staging_slots(stripes) * EM_STAGING_BATCH * sizeof(IPItem) +
+           stripes * equihash::IPBlockCodec<IPItem>::max_encoded_bytes(EM_BLOCK_ITEMS) +
+           (direct_io ? stripes * static_cast<std::size_t>(EM_DIRECT_CHUNK) + 2 * EM_DIRECT_ALIGN : 0);
+}
+
+// Number of entries in a comma-separated `--em=` list.
+inline std::size_t em_path_count(const std::string &spec)
+{
+    return static_cast<std::size_t>(std::count(spec.begin(), spec.end(), ',')) + 1;
+}
+
+// Split a comma-separated `--em=` list into one file per stripe. Entries
+// naming a directory get `file_name` inside it (suffixed with the stripe
+// number when striping, so two entries may share a directory).
+inline std::vector<std::string> em_split_paths(const std::string &spec, const char *file_name)
+{
+    std::vector<std::string> out;
+    const size_t count = em_path_count(spec);
+    size_t pos = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t comma = std::min(spec.find(',', pos), spec.size());
+        std::string path = spec.substr(pos, comma - pos);
+        pos = comma + 1;
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            path += '/';
+            path += file_name;
+            if (count > 1)
+                path += '.' + std::to_string(i);
+        }
+        out.push_back(std::move(path));
+    }
+    return out;
+}
+
+namespace em_detail
+{
+inline uint8_t *align_up(uint8_t *p)
+{
+    const uintptr_t a = EM_DIRECT_ALIGN;
+    return reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(p) + a - 1) & ~(a - 1));
+}
+
+// Open `path` with O_DIRECT when asked; filesystems without direct I/O
+// support (e.g. tmpfs reports EINVAL) fall back to buffered I/O and clear
+// `direct`.
+inline int open_file(const char *path, int flags, bool &direct)
+{
+#if defined(O_DIRECT)
+    if (direct)
+    {
+        const int fd = ::open(path, flags | O_DIRECT, 0644);
+        if (fd >= 0 || errno != EINVAL)
+            return fd;
+        std::fprintf(stderr, "O_DIRECT not supported for %s, using buffered I/O\n", path);
+    }
+#endif
+    direct = false;
+    return ::open(path, flags, 0644);
+}
+
+// pwrite/pread the whole range, retrying short transfers. `read` stops at EOF
+// and returns the byte count actually transferred.
+inline size_t pwrite_all(int fd, const void *data, size_t bytes, uint64_t off)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    size_t done = 0;
+    while (done < bytes)
+    {
+        const ssize_t r = ::pwrite(fd, p + done, bytes - done, static_cast<off_t>(off + done));
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            break;
+        done += static_cast<size_t>(r);
+    }
+    return done;
+}
+
+inline size_t pread_all(int fd, void *data, size_t bytes, uint64_t off)
+{
+    uint8_t *p = static_cast<uint8_t *>(data);
+    size_t done = 0;
+    while (done < bytes)
+    {
+        const ssize_t r = ::pread(fd, p + done, bytes - done, static_cast<off_t>(off + done));
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            break;
+        done += static_cast<size_t>(r);
+    }
+    return done;
+}
+} // namespace em_detail
+
+
+// ------------------ IP writer with background I/O stage ------------------
+// IP pairs are `push`ed into fixed-size staging buffers. A full buffer is
+// handed to a writer thread and the merge keeps filling the next one, so the
+// merge only stalls when every buffer is still in flight (i.e. the disk is
+// the bottleneck). The staging buffers are carved from caller-provided memory
+// (`attach_staging`) so they count against the solver's arena; without one,
+// `open` falls back to a private heap buffer.
+//
+// In PACKED format the writer thread also encodes each batch into
+// IPBlockCodec blocks and records them in an IPBlockIndex; offsets returned to
+// callers stay logical (raw-record) offsets in both formats.
+//
+// With `set_direct(true)` the file is opened with O_DIRECT so written layers
+// do not linger in the page cache. Slots are then aligned and sized in whole
+// EM_DIRECT_ALIGN units, so full RAW batches go to disk straight from the
+// slot; everything else is packed into an aligned tail chunk. A partial tail
+// is written zero-padded and rewritten once it grows; `close` truncates the
+// file to its real length.
+//
+// Opened with several paths, the writer stripes batches round-robin over
+// them, one writer thread per file, and `stripe_map` records where every
+// batch (extent) landed.
+template <typename IPItem>
+class IPDiskWriter
+{
+public:
+    uint64_t cursor_;
+
+    IPDiskWriter() : cursor_(0) {}
+    ~IPDiskWriter() { close(); }
+    IPDiskWriter(const IPDiskWriter &) = delete;
+    IPDiskWriter &operator=(const IPDiskWriter &) = delete;
+
+    // Use [buf, buf + bytes) as staging memory; must be called before `open`.
+    void attach_staging(uint8_t *buf, size_t bytes)
+    {
+        staging_ = buf;
+        staging_bytes_ = bytes;
+    }
+
+    // Select the on-disk layout; must be called before `open`.
+    void set_format(IPDiskFormat fmt) { format_ = fmt; }
+    IPDiskFormat format() const { return format_; }
+
+    // Request O_DIRECT; must be called before `open`. `direct()` reports
+    // whether every open file actually uses it.
+    void set_direct(bool on) { want_direct_ = on; }
+    bool direct() const
+    {
+        return !lanes_.empty() && std::all_of(lanes_.begin(), lanes_.end(), [](const Lane &l)
+                                              { return l.direct; });
+    }
+
+    bool open(const char *p) { return open(std::vector<std::string>{p}); }
+
+    // One file per stripe.
+    bool open(const std::vector<std::string> &paths)
+    {
+        close();
+        if (paths.empty())
+            return false;
+        paths_ = paths;
+        lanes_ = std::vector<Lane>(paths.size());
+        for (size_t i = 0; i < lanes_.size(); ++i)
+        {
+            Lane &lane = lanes_[i];
+            lane.direct = want_direct_;
+            lane.fd = em_detail::open_file(paths[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC, lane.direct);
+            if (lane.fd < 0)
+            {
+                std::perror(paths[i].c_str());
+                close();
+                return false;
+            }
+        }
+        cursor_ = 0;
+        batch_no_ = 0;
+        setup_slots();
+        failed_ = false;
+        stop_ = false;
+        threaded_ = slots_.size() > 1;
+        if (threaded_)
+        {
+            for (Lane &lane : lanes_)
+                lane.worker = std::thread(&IPDiskWriter::worker_loop, this, std::ref(lane));
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (!lanes_.empty())
+        {
+            sync();
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                stop_ = true;
+            }
+            cv_.notify_all();
+            for (Lane &lane : lanes_)
+            {
+                if (lane.worker.joinable())
+                    lane.worker.join();
+                if (lane.fd < 0)
+                    continue;
+                if (lane.direct && ::ftruncate(lane.fd, static_cast<off_t>(lane.file_pos)) != 0)
+                    std::perror("ftruncate");
+                ::close(lane.fd);
+            }
+            lanes_.clear();
+        }
+        slots_.clear();
+        own_staging_.clear();
+        own_staging_.shrink_to_fit();
+        threaded_ = false;
+        cur_ = fill_ = 0;
+        cursor_ = 0;
+    }
+
+    // Append one IP pair; hands the current buffer to the writer when full.
+    inline void push(const IPItem &ip)
+    {
+        slots_[cur_].data[fill_++] = ip;
+        if (fill_ == batch_)
+            flush();
+    }
+
+    // Hand the partially filled buffer to the writer (non-blocking unless all
+    // buffers are in flight).
+    void flush()
+    {
+        if (lanes_.empty() || fill_ == 0)
+            return;
+        const size_t n = fill_;
+        const uint64_t first_item = cursor_ / sizeof(IPItem);
+        cursor_ += n * sizeof(IPItem);
+        fill_ = 0;
+        Lane &lane = next_lane();
+        if (!threaded_)
+        {
+            write_batch(lane, slots_[cur_].data, n, first_item);
+            return;
+        }
+        std::unique_lock<std::mutex> lk(mu_);
+        slots_[cur_].count = n;
+        slots_[cur_].first_item = first_item;
+        slots_[cur_].busy = true;
+        lane.queue.push_back(cur_);
+        cv_.notify_all();
+        cur_ = (cur_ + 1) % slots_.size();
+        cv_.wait(lk, [&]
+                 { return !slots_[cur_].busy; });
+    }
+
+    // Flush and wait until every queued buffer reached the file.
+    bool sync()
+    {
+        if (lanes_.empty())
+            return false;
+        flush();
+        if (threaded_)
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            cv_.wait(lk, [&]
+                     { return std::all_of(lanes_.begin(), lanes_.end(), [](const Lane &l)
+                                          { return l.queue.empty(); }); });
+        }
+        for (Lane &lane : lanes_)
+        {
+            if (lane.direct)
+                write_dio_tail(lane);
+        }
+        return !failed_;
+    }
+
+    uint64_t append_layer(const IPItem *data, size_t n)
+    {
+        if (lanes_.empty() || !n)
+            return get_current_offset();
+        sync();
+        uint64_t off = cursor_;
+        write_batch(next_lane(), data, n, cursor_ / sizeof(IPItem));
+        cursor_ += n * sizeof(IPItem);
+        return off;
+    }
+
+    bool write_ip_item(const IPItem &item)
+    {
+        if (lanes_.empty())
+            return false;
+        push(item);
+        return !failed_;
+    }
+
+    // Logical end of the IP stream, including items still being staged.
+    size_t get_current_offset() const
+    {
+        return cursor_ + fill_ * sizeof(IPItem);
+    }
+
+    bool failed() const { return failed_; }
+    size_t stripe_count() const { return lanes_.size(); }
+
+    // Block index of everything written so far (empty for RAW). Call before
+    // `close`; the manifest keeps the returned copy.
+    equihash::IPBlockIndex block_index()
+    {
+        sync();
+        if (format_ != IPDiskFormat::PACKED || lanes_.empty())
+            return {};
+        std::vector<std::pair<uint64_t, uint64_t>> all;
+        uint64_t phys_end = 0;
+        for (const Lane &lane : lanes_)
+        {
+            for (size_t b = 0; b < lane.blk_first.size(); ++b)
+                all.emplace_back(lane.blk_first[b], lane.blk_offset[b]);
+            phys_end += lane.file_pos;
+        }
+        std::sort(all.begin(), all.end());
+        equihash::IPBlockIndex idx;
+        idx.first_item.reserve(all.size() + 1);
+        idx.file_offset.reserve(all.size() + 1);
+        for (const auto &b : all)
+        {
+            idx.first_item.push_back(b.first);
+            idx.file_offset.push_back(b.second);
+        }
+        idx.first_item.push_back(cursor_ / sizeof(IPItem));
+        idx.file_offset.push_back(phys_end);
+        return idx;
+    }
+
+    // Extent placement of a striped store (empty for a single file). Call
+    // before `close`.
+    equihash::IPStripeMap stripe_map()
+    {
+        sync();
+        if (lanes_.size() < 2)
+            return {};
+        struct Ext
+        {
+            uint64_t first, offset, bytes;
+            uint32_t stripe;
+            bool operator<(const Ext &o) const { return first < o.first; }
+        };
+        std::vector<Ext> all;
+        for (size_t s = 0; s < lanes_.size(); ++s)
+        {
+            const Lane &lane = lanes_[s];
+            for (size_t e = 0; e < lane.ext_first.size(); ++e)
+                all.push_back({lane.ext_first[e], lane.ext_offset[e], lane.ext_bytes[e], static_cast<uint32_t>(s)});
+        }
+        std::sort(all.begin(), all.end());
+        equihash::IPStripeMap map;
+        map.paths = paths_;
+        for (const Ext &e : all)
+        {
+            map.first_item.push_back(e.first);
+            map.stripe.push_back(e.stripe);
+            map.file_offset.push_back(e.offset);
+            map.bytes.push_back(e.bytes);
+        }
+        map.first_item.push_back(cursor_ / sizeof(IPItem));
+        return map;
+    }
+
+private:
+    struct Slot
+    {
+        IPItem *data = nullptr;
+        size_t count = 0;
+        uint64_t first_item = 0;
+        bool busy = false;
+    };
+
+    // One output file with its own writer thread and write cursor.
+    struct Lane
+    {
+        int fd = -1;
+        bool direct = false;
+        uint64_t file_pos = 0;     // physical bytes written
+        uint8_t *enc = nullptr;    // one encoded block
+        uint8_t *dio = nullptr;    // aligned EM_DIRECT_CHUNK tail buffer
+        uint64_t dio_base = 0;     // file offset of dio[0] (aligned)
+        size_t dio_fill = 0;       // bytes of dio holding data
+        std::deque<size_t> queue;  // slots waiting for this lane, guarded by mu_
+        std::thread worker;
+        std::vector<uint64_t> ext_first, ext_offset, ext_bytes; // batches written here
+        std::vector<uint64_t> blk_first, blk_offset;            // PACKED blocks written here
+    };
+
+    using Codec = equihash::IPBlockCodec<IPItem>;
+
+    uint8_t *staging_ = nullptr;
+    size_t staging_bytes_ = 0;
+    std::vector<uint8_t> own_staging_;
+    std::vector<Slot> slots_;
+    std::vector<Lane> lanes_;
+    std::vector<std::string> paths_;
+    IPDiskFormat format_ = IPDiskFormat::RAW;
+    bool want_direct_ = false;
+    bool threaded_ = false;
+    size_t batch_ = 0;
+    size_t cur_ = 0;
+    size_t fill_ = 0;
+    uint64_t batch_no_ = 0;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::atomic<bool> failed_{false};
+
+    Lane &next_lane() { return lanes_[batch_no_++ % lanes_.size()]; }
+
+    void setup_slots()
+    {
+        constexpr size_t enc_bytes = Codec::max_encoded_bytes(EM_BLOCK_ITEMS);
+        const size_t nlanes = lanes_.size();
+        const size_t nslots = em_staging_slots(nlanes);
+        const size_t dio_bytes = want_direct_ ? nlanes * EM_DIRECT_CHUNK + 2 * EM_DIRECT_ALIGN : 0;
+        uint8_t *buf = staging_;
+        size_t bytes = staging_bytes_;
+        if (!buf || bytes < nlanes * enc_bytes + dio_bytes + nslots * EM_DIRECT_ALIGN * sizeof(IPItem))
+        {
+            own_staging_.resize(em_staging_bytes<IPItem>(want_direct_, nlanes));
+            buf = own_staging_.data();
+            bytes = own_staging_.size();
+        }
+        // [aligned tail chunk per lane][slots] ... [encoder block per lane]
+        bytes -= nlanes * enc_bytes;
+        for (size_t l = 0; l < nlanes; ++l)
+            lanes_[l].enc = buf + bytes + l * enc_bytes;
+        if (want_direct_)
+        {
+            // Each slot is a whole number of EM_DIRECT_ALIGN units so full
+            // batches can be written in place.
+            uint8_t *end = buf + bytes;
+            buf = em_detail::align_up(buf);
+            for (Lane &lane : lanes_)
+            {
+                lane.dio = buf;
+                buf += EM_DIRECT_CHUNK;
+            }
+            bytes = static_cast<size_t>(end - buf);
+        }
+        batch_ = std::min<size_t>(bytes / sizeof(IPItem) / nslots, EM_STAGING_BATCH);
+        if (want_direct_)
+            batch_ -= batch_ % EM_DIRECT_ALIGN;
+        slots_.assign(nslots, Slot{});
+        for (size_t s = 0; s < nslots; ++s)
+            slots_[s].data = reinterpret_cast<IPItem *>(buf) + s * batch_;
+        cur_ = fill_ = 0;
+    }
+
+    void write_raw(Lane &lane, const void *data, size_t bytes)
+    {
+        if (lane.direct)
+        {
+            write_direct(lane, static_cast<const uint8_t *>(data), bytes);
+            return;
+        }
+        if (em_detail::pwrite_all(lane.fd, data, bytes, lane.file_pos) != bytes)
+        {
+            std::perror("pwrite");
+            failed_ = true;
+        }
+        lane.file_pos += bytes;
+    }
+
+    void pwrite_aligned(Lane &lane, const void *data, size_t bytes, uint64_t off)
+    {
+        if (em_detail::pwrite_all(lane.fd, data, bytes, off) != bytes)
+        {
+            std::perror("pwrite(O_DIRECT)");
+            failed_ = true;
+        }
+    }
+
+    // Append through the aligned tail chunk; whole chunks go out as they fill.
+    void write_direct(Lane &lane, const uint8_t *data, size_t bytes)
+    {
+        // Aligned data with an empty tail is written in place (RAW batches).
+        const size_t whole = bytes & ~static_cast<size_t>(EM_DIRECT_ALIGN - 1);
+        if (lane.dio_fill == 0 && whole && (reinterpret_cast<uintptr_t>(data) & (EM_DIRECT_ALIGN - 1)) == 0)
+        {
+            pwrite_aligned(lane, data, whole, lane.dio_base);
+            lane.dio_base += whole;
+            lane.file_pos += whole;
+            data += whole;
+            bytes -= whole;
+        }
+        while (bytes)
+        {
+            const size_t take = std::min<size_t>(bytes, EM_DIRECT_CHUNK - lane.dio_fill);
+            std::memcpy(lane.dio + lane.dio_fill, data, take);
+            lane.dio_fill += take;
+            lane.file_pos += take;
+            data += take;
+            bytes -= take;
+            if (lane.dio_fill == EM_DIRECT_CHUNK)
+            {
+                pwrite_aligned(lane, lane.dio, EM_DIRECT_CHUNK, lane.dio_base);
+                lane.dio_base += EM_DIRECT_CHUNK;
+                lane.dio_fill = 0;
+            }
+        }
+    }
+
+    // Make the partial tail durable (zero-padded to the alignment). The
+    // whole-unit prefix is retired so the tail stays small; the rest is
+    // rewritten by the next write.
+    void write_dio_tail(Lane &lane)
+    {
+        if (lane.dio_fill == 0)
+            return;
+        const size_t a = EM_DIRECT_ALIGN;
+        const size_t padded = (lane.dio_fill + a - 1) & ~(a - 1);
+        std::memset(lane.dio + lane.dio_fill, 0, padded - lane.dio_fill);
+        pwrite_aligned(lane, lane.dio, padded, lane.dio_base);
+        const size_t keep = lane.dio_fill & (a - 1);
+        const size_t retire = lane.dio_fill - keep;
+        if (retire)
+        {
+            std::memmove(lane.dio, lane.dio + retire, keep);
+            lane.dio_base += retire;
+            lane.dio_fill = keep;
+        }
+    }
+
+    // Write `n` items whose logical position starts at `first_item`.
+    void write_batch(Lane &lane, const IPItem *data, size_t n, uint64_t first_item)
+    {
+        const uint64_t start = lane.file_pos;
+        if (format_ == IPDiskFormat::RAW)
+        {
+            write_raw(lane, data, n * sizeof(IPItem));
+        }
+        else
+        {
+            for (size_t i = 0; i < n; i += EM_BLOCK_ITEMS)
+            {
+                const size_t cnt = std::min<size_t>(EM_BLOCK_ITEMS, n - i);
+                lane.blk_first.push_back(first_item + i);
+                lane.blk_offset.push_back(lane.file_pos);
+                write_raw(lane, lane.enc, Codec::encode(data + i, cnt, lane.enc));
+            }
+        }
+        lane.ext_first.push_back(first_item);
+        lane.ext_offset.push_back(start);
+        lane.ext_bytes.push_back(lane.file_pos - start);
+    }
+
+    void worker_loop(Lane &lane)
+    {
+        std::unique_lock<std::mutex> lk(mu_);
+        for (;;)
+        {
+            cv_.wait(lk, [&]
+                     { return stop_ || !lane.queue.empty(); });
+            if (lane.queue.empty())
+                return;
+            const size_t s = lane.queue.front();
+            lk.unlock();
+            write_batch(lane, slots_[s].data, slots_[s].count, slots_[s].first_item);
+            lk.lock();
+            slots_[s].busy = false;
+            lane.queue.pop_front();
+            cv_.notify_all();
+        }
+    }
+};
+
+// Reads IP items by logical position. With a block index attached
+// (`set_block_index`), the covering blocks are read in one request and
+// decoded; otherwise the file is treated as raw `IPItem` records.
+//
+// With `set_direct(true)` reads bypass the page cache: each request is
+// widened to aligned EM_DIRECT_CHUNK transfers through a bounce buffer taken
+// from `attach_staging` memory (or a private one).
+//
+// Opened with several paths and given the writer's IPStripeMap, a request is
+// split at extent boundaries and the pieces are read by one thread per
+// stripe file, so all devices work on it at once.
+template <typename IPItem>
+class IPDiskReader
+{
+public:
+    IPDiskReader() {}
+    ~IPDiskReader() { close(); }
+    IPDiskReader(const IPDiskReader &) = delete;
+    IPDiskReader &operator=(const IPDiskReader &) = delete;
+
+    // Use [buf, buf + bytes) for the O_DIRECT bounce buffers; call before `open`.
+    void attach_staging(uint8_t *buf, size_t bytes)
+    {
+        staging_ = buf;
+        staging_bytes_ = bytes;
+    }
+
+    void set_direct(bool on) { want_direct_ = on; }
+    bool direct() const
+    {
+        return !lanes_.empty() && std::all_of(lanes_.begin(), lanes_.end(), [](const Lane &l)
+                                              { return l.direct; });
+    }
+
+    bool open(const char *p) { return open(std::vector<std::string>{p}); }
+
+    bool open(const std::vector<std::string> &paths)
+    {
+        close();
+        if (paths.empty())
+            return false;
+        lanes_ = std::vector<Lane>(paths.size());
+        uint8_t *stage = staging_ ? em_detail::align_up(staging_) : nullptr;
+        uint8_t *stage_end = staging_ + staging_bytes_;
+        for (size_t i = 0; i < lanes_.size(); ++i)
+        {
+            Lane &lane = lanes_[i];
+            lane.direct = want_direct_;
+            lane.fd = em_detail::open_file(paths[i].c_str(), O_RDONLY, lane.direct);
+            if (lane.fd < 0)
+            {
+                std::perror(paths[i].c_str());
+                close();
+                return false;
+            }
+            if (!lane.direct)
+                continue;
+            if (stage && stage + EM_DIRECT_CHUNK <= stage_end)
+            {
+                lane.bounce = stage;
+                stage += EM_DIRECT_CHUNK;
+            }
+            else
+            {
+                lane.own_bounce.resize(EM_DIRECT_CHUNK + EM_DIRECT_ALIGN);
+                lane.bounce = em_detail::align_up(lane.own_bounce.data());
+            }
+        }
+        stop_ = false;
+        if (lanes_.size() > 1)
+        {
+            for (Lane &lane : lanes_)
+                lane.worker = std::thread(&IPDiskReader::worker_loop, this, std::ref(lane));
+        }
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (Lane &lane : lanes_)
+        {
+            if (lane.worker.joinable())
+                lane.worker.join();
+            if (lane.fd >= 0)
+                ::close(lane.fd);
+        }
+        lanes_.clear();
+    }
+
+    // Attach the index of a PACKED file (nullptr or empty = RAW).
+    void set_block_index(const equihash::IPBlockIndex *idx)
+    {
+        blocks_ = (idx && !idx->empty()) ? idx : nullptr;
+    }
+
+    // Attach the extent map of a striped store (nullptr or empty = one file).
+    void set_stripe_map(const equihash::IPStripeMap *map)
+    {
+        stripes_ = (map && !map->empty()) ? map : nullptr;
+    }
+
+    size_t stripe_count() const { return lanes_.empty() ? 1 : lanes_.size(); }
+
+    bool read_slice(uint64_t off, uint32_t cnt, LayerVec<IPItem> &out)
+    {
+        out.resize(cnt);
+        return read_items(off / sizeof(IPItem), cnt, out.data());
+    }
+
+    // Read the logical items [first, first + n).
+    bool read_items(uint64_t first, size_t n, IPItem *out)
+    {
+        if (lanes_.empty())
+            return false;
+        if (n == 0)
+            return true;
+        if (!stripes_)
+            return read_piece(lanes_[0], whole_file_piece(first, n, out));
+
+        size_t busy = 0;
+        for_each_piece(first, n, out, [&](Lane &lane, const Piece &p)
+                       {
+                           busy += lane.jobs.empty();
+                           lane.jobs.push_back(p); });
+        bool ok = true;
+        if (busy < 2 || lanes_.size() < 2)
+        {
+            for (Lane &lane : lanes_)
+                ok &= run_jobs(lane);
+            return ok;
+        }
+        std::unique_lock<std::mutex> lk(mu_);
+        pending_ = busy;
+        read_failed_ = false;
+        for (Lane &lane : lanes_)
+            lane.ready = !lane.jobs.empty();
+        cv_.notify_all();
+        cv_.wait(lk, [&]
+                 { return pending_ == 0; });
+        return !read_failed_;
+    }
+
+    // Hint the kernel to start reading the logical items [first, first + n).
+    void advise_items(uint64_t first, size_t n)
+    {
+        if (lanes_.empty() || n == 0)
+            return;
+        auto advise = [&](Lane &lane, const Piece &p)
+        {
+            if (lane.direct)
+                return;
+            uint64_t lo, hi;
+            physical_range(p, lo, hi);
+            advise_willneed(lane, lo, hi - lo);
+        };
+        if (!stripes_)
+            advise(lanes_[0], whole_file_piece(first, n, nullptr));
+        else
+            for_each_piece(first, n, nullptr, advise);
+    }
+
+    bool read_ip_item(uint64_t off, IPItem &out)
+    {
+        return read_items(off / sizeof(IPItem), 1, &out);
+    }
+
+private:
+    using Codec = equihash::IPBlockCodec<IPItem>;
+
+    // Logical items [first, first + n) that live in one file. `raw_off` is
+    // the physical offset of `first` in a RAW file; a PACKED piece's blocks
+    // end at the first block at or after `ext_end_item`, or at `ext_end_off`.
+    struct Piece
+    {
+        uint64_t first;
+        size_t n;
+        IPItem *out;
+        uint64_t raw_off;
+        uint64_t ext_end_item;
+        uint64_t ext_end_off;
+    };
+
+    // One input file with its own buffers and reader thread.
+    struct Lane
+    {
+        int fd = -1;
+        bool direct = false;
+        uint8_t *bounce = nullptr;
+        std::vector<uint8_t> own_bounce;
+        std::vector<uint8_t> enc_buf;
+        std::vector<IPItem> dec_buf;
+        std::vector<Piece> jobs;
+        bool ready = false; // guarded by mu_
+        std::thread worker;
+    };
+
+    std::vector<Lane> lanes_;
+    const equihash::IPBlockIndex *blocks_ = nullptr;
+    const equihash::IPStripeMap *stripes_ = nullptr;
+    bool want_direct_ = false;
+    uint8_t *staging_ = nullptr;
+    size_t staging_bytes_ = 0;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    size_t pending_ = 0;
+    bool read_failed_ = false;
+    bool stop_ = false;
+
+    static Piece whole_file_piece(uint64_t first, size_t n, IPItem *out)
+    {
+        return Piece{first, n, out, first * sizeof(IPItem), ~0ull, 0};
+    }
+
+    // Split [first, first + n) at extent boundaries of the stripe map.
+    template <typename F>
+    void for_each_piece(uint64_t first, size_t n, IPItem *out, F &&f)
+    {
+        const auto &fi = stripes_->first_item;
+        size_t e = static_cast<size_t>(std::upper_bound(fi.begin(), fi.end(), first) - fi.begin()) - 1;
+        const uint64_t end = first + n;
+        for (uint64_t pos = first; pos < end && e < stripes_->extent_count(); ++e)
+        {
+            const uint64_t to = std::min<uint64_t>(end, fi[e + 1]);
+            const Piece p{pos, static_cast<size_t>(to - pos), out ? out + (pos - first) : nullptr,
+                          stripes_->file_offset[e] + (pos - fi[e]) * sizeof(IPItem),
+                          fi[e + 1], stripes_->file_offset[e] + stripes_->bytes[e]};
+            f(lanes_[stripes_->stripe[e]], p);
+            pos = to;
+        }
+    }
+
+    // Physical byte range [lo, hi) holding a piece.
+    void physical_range(const Piece &p, uint64_t &lo, uint64_t &hi) const
+    {
+        if (!blocks_)
+        {
+            lo = p.raw_off;
+            hi = p.raw_off + p.n * sizeof(IPItem);
+            return;
+        }
+        size_t b0, b1;
+        block_range(p.first, p.n, b0, b1);
+        lo = blocks_->file_offset[b0];
+        hi = blocks_->first_item[b1] < p.ext_end_item ? blocks_->file_offset[b1] : p.ext_end_off;
+    }
+
+    bool read_piece(Lane &lane, const Piece &p)
+    {
+        uint64_t lo, hi;
+        physical_range(p, lo, hi);
+        if (!blocks_)
+            return read_bytes(lane, lo, p.out, hi - lo);
+
+        size_t b0, b1;
+        block_range(p.first, p.n, b0, b1);
+        lane.enc_buf.resize(hi - lo + 8); // BitReader slack
+        std::memset(lane.enc_buf.data() + (hi - lo), 0, 8);
+        if (!read_bytes(lane, lo, lane.enc_buf.data(), hi - lo))
+            return false;
+        for (size_t b = b0; b < b1; ++b)
+        {
+            const uint64_t bf = blocks_->first_item[b];
+            const size_t bn = static_cast<size_t>(blocks_->first_item[b + 1] - bf);
+            lane.dec_buf.resize(bn);
+            Codec::decode(lane.enc_buf.data() + (blocks_->file_offset[b] - lo), bn, lane.dec_buf.data());
+            const uint64_t from = std::max<uint64_t>(p.first, bf);
+            const uint64_t to = std::min<uint64_t>(p.first + p.n, bf + bn);
+            std::memcpy(p.out + (from - p.first), lane.dec_buf.data() + (from - bf),
+                        static_cast<size_t>(to - from) * sizeof(IPItem));
+        }
+        return true;
+    }
+
+    bool run_jobs(Lane &lane)
+    {
+        bool ok = true;
+        for (const Piece &p : lane.jobs)
+            ok &= read_piece(lane, p);
+        lane.jobs.clear();
+        return ok;
+    }
+
+    void worker_loop(Lane &lane)
+    {
+        std::unique_lock<std::mutex> lk(mu_);
+        for (;;)
+        {
+            cv_.wait(lk, [&]
+                     { return stop_ || lane.ready; });
+            if (!lane.ready)
+                return;
+            lane.ready = false;
+            lk.unlock();
+            const bool ok = run_jobs(lane);
+            lk.lock();
+            read_failed_ |= !ok;
+            if (--pending_ == 0)
+                cv_.notify_all();
+        }
+    }
+
+    // Read `bytes` raw bytes at physical offset `off`.
+    bool read_bytes(Lane &lane, uint64_t off, void *dst, size_t bytes)
+    {
+        if (lane.direct)
+            return read_direct(lane, off, static_cast<uint8_t *>(dst), bytes);
+        if (em_detail::pread_all(lane.fd, dst, bytes, off) != bytes)
+        {
+            std::perror("pread");
+            return false;
+        }
+        return true;
+    }
+
+    // Aligned chunked reads into the bounce buffer; a short read is fine as
+    // long as it still covers the requested bytes (file tail).
+    bool read_direct(Lane &lane, uint64_t off, uint8_t *dst, size_t bytes)
+    {
+        const uint64_t mask = EM_DIRECT_ALIGN - 1;
+        while (bytes)
+        {
+            const uint64_t a0 = off & ~mask;
+            const size_t lead = static_cast<size_t>(off - a0);
+            const size_t want = std::min<size_t>(static_cast<size_t>((lead + bytes + mask) & ~mask), EM_DIRECT_CHUNK);
+            const size_t got = em_detail::pread_all(lane.fd, lane.bounce, want, a0);
+            if (got <= lead)
+            {
+                std::perror("pread(O_DIRECT)");
+                return false;
+            }
+            const size_t take = std::min(bytes, got - lead);
+            std::memcpy(dst, lane.bounce + lead, take);
+            dst += take;
+            off += take;
+            bytes -= take;
+        }
+        return true;
+    }
+
+    // Hint the kernel to start reading [off, off + len) ahead of use.
+    void advise_willneed(Lane &lane, uint64_t off, uint64_t len)
+    {
+#if defined(POSIX_FADV_WILLNEED)
+        ::posix_fadvise(lane.fd, static_cast<off_t>(off), static_cast<off_t>(len), POSIX_FADV_WILLNEED);
+#else
+        (void)lane;
+        (void)off;
+        (void)len;
+#endif
+    }
+
+    // Blocks [b0, b1) cover the logical items [first, first + n).
+    void block_range(uint64_t first, size_t n, size_t &b0, size_t &b1) const
+    {
+        const auto &fi = blocks_->first_item;
+        b0 = static_cast<size_t>(std::upper_bound(fi.begin(), fi.end(), first) - fi.begin()) - 1;
+        b1 = static_cast<size_t>(std::lower_bound(fi.begin() + b0, fi.end(), first + n) - fi.begin());
+        b1 = std::min(b1, blocks_->block_count());
+    }
+};
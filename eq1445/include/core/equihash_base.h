@@ -7,6 +7,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <new>
+#include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -170,10 +171,43 @@ struct IPDiskMetaT
     std::uint64_t stride = sizeof(ItemIP);
 };
 
+// Seekable index of a block-compressed IP file. Block b holds the logical IP
+// items [first_item[b], first_item[b + 1]) and its encoded bytes live at
+// [file_offset[b], file_offset[b + 1]). Both vectors carry an end sentinel.
+// An empty index means the file stores raw `ItemIP` records. In a striped
+// store offsets are relative to the block's stripe file and a block ends at
+// the next block of its extent or at the extent end (see IPStripeMap).
+struct IPBlockIndex
+{
+    std::vector<std::uint64_t> first_item;
+    std::vector<std::uint64_t> file_offset;
+
+    bool empty() const { return first_item.size() < 2; }
+    std::size_t block_count() const { return empty() ? 0 : first_item.size() - 1; }
+};
+
+// Placement of a striped IP store. Extent e holds the logical IP items
+// [first_item[e], first_item[e + 1]) and lives in paths[stripe[e]] at
+// [file_offset[e], file_offset[e] + bytes[e]). `first_item` carries an end
+// sentinel. An empty map means a single unstriped file.
+struct IPStripeMap
+{
+    std::vector<std::string> paths;
+    std::vector<std::uint64_t> first_item;
+    std::vector<std::uint32_t> stripe;
+    std::vector<std::uint64_t> file_offset;
+    std::vector<std::uint64_t> bytes;
+
+    bool empty() const { return first_item.size() < 2; }
+    std::size_t extent_count() const { return empty() ? 0 : first_item.size() - 1; }
+};
+
 template <typename ItemIP, std::size_t LayerCount>
 struct IPDiskManifestT
 {
     std::array<IPDiskMetaT<ItemIP>, LayerCount> ip;
+    IPBlockIndex blocks;  // offsets in `ip` stay logical (raw-record) offsets
+    IPStripeMap stripes;  // where each extent of the logical stream lives
 };
 
 } // namespace equihash
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace equihash
+{
+// Parameter set derived from (N, K) alone. Exposes the same members as the
+// hand-written EquihashParams_200_9 / EquihashParams_144_5 structs, plus
+// layer_xor_bytes(i) for the generic layer types in eqgen/equihash_gen.h.
+//
+// One BLAKE2b call per hash index yields kLeavesPerHash = 512 / N leaves
+// of ceil(N / 8) bytes each. For N % 8 == 0 that is the Zcash layout. For
+// other N the leaves are not bit-packed as in the Equihash spec: each is
+// padded to ceil(N / 8) bytes of the digest and the bits above N in its top
+// byte are cleared (kLeafTopMask), so the final layer still XORs to zero.
+// Solutions of such sets (apr_210_9, ...) are therefore not comparable with
+// a standard (N, K) implementation.
+template <std::uint32_t N_, std::uint32_t K_>
+struct EquihashParamsT
+{
+    static constexpr std::uint32_t N = N_;
+    static constexpr std::uint32_t K = K_;
+
+    static constexpr std::size_t kCollisionBitLength = N / (K + 1);
+
+    // Layer i holds the N - i * ell bits that are not yet collided.
+    static constexpr std::size_t layer_xor_bytes(std::size_t i)
+    {
+        return (N - i * kCollisionBitLength + 7) / 8;
+    }
+
+    static constexpr std::size_t kLayer0XorBytes = layer_xor_bytes(0);
+
+    static constexpr std::uint32_t kLeafCountHalf = 1u << kCollisionBitLength;
+    static constexpr std::uint32_t kLeafCountFull = kLeafCountHalf * 2u;
+
+    // Lists run a few percent over 2^(ell+1); two spare bits cover positions
+    // up to kMaxListSize in the index pointers.
+    static constexpr std::size_t kMaxListSize = kLeafCountFull + kLeafCountFull / 20;
+    static constexpr std::size_t kInitialListSize = kLeafCountFull;
+    static constexpr std::size_t kIndexBytes = (kCollisionBitLength + 2 + 7) / 8;
+
+    static constexpr std::size_t kLeavesPerHash = (512 / N) > 0 ? 512 / N : 1;
+    static constexpr std::size_t kHashOutputBytes = kLeavesPerHash * ((N + 7) / 8);
+    static constexpr std::uint32_t kHashCount =
+        static_cast<std::uint32_t>((kLeafCountFull + kLeavesPerHash - 1) / kLeavesPerHash);
+    static constexpr std::uint8_t kLeafTopMask =
+        (N % 8) ? static_cast<std::uint8_t>((1u << (N % 8)) - 1) : std::uint8_t(0xFF);
+
+    static_assert(N % (K + 1) == 0, "N must be a multiple of K + 1");
+    static_assert(K >= 2, "Equihash needs at least two rounds");
+    static_assert(kCollisionBitLength + 1 < 32,
+                  "leaf indices are 32-bit: 2^(N/(K+1)+1) leaves must fit");
+    static_assert(kHashOutputBytes <= 64, "one BLAKE2b output must hold kLeavesPerHash leaves");
+};
+} // namespace equihash
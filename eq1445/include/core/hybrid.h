@@ -0,0 +1,448 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "core/merge.h"
+#include "core/sort.h"
+#include "core/util.h"
+
+// ------------------ Hybrid: two switching heights ------------------
+// Requires EquihashParams, Item_IP and Layer_IP from the including
+// translation unit (include the variant's util header first).
+//
+// The single-chain hybrid of the estimators (search_best_hybrid_single_chian
+// in python-poc/wagner_algorithmic_estimator.py), with 0 <= h1 < h2 <= K-1:
+//
+//   layers 0..h1      index vectors with XOR removal: an item keeps the
+//                     leaves below it and only the head of its XOR (the
+//                     next key and the zero check); merges rehash the
+//                     leaves for the full XOR
+//   layers h1+1..h2   XOR only; IP{h1+2..h2} are recomputed during the
+//                     expansion (post-retrieval), and IP{h1+1} is never
+//                     stored: its pairs point at index vectors, so
+//                     recomputing it yields leaves directly
+//   layers h2..K-1    indexed; IP{h2+1..K-1} kept in RAM, stacked down
+//                     from the end of the arena as they are produced
+//
+// RAM IP layers are expanded before anything is recomputed, so every
+// recomputation has the whole arena.
+
+// Layer i holds the N - i * ell bits that are not yet collided.
+inline constexpr size_t hybrid_xor_bytes(size_t i)
+{
+    return (EquihashParams::N - i * EquihashParams::kCollisionBitLength + 7) / 8;
+}
+
+// XOR head kept by index-vector items: the 5 bytes is_zero_item checks.
+inline constexpr size_t hybrid_head_bytes(size_t i)
+{
+    return std::min<size_t>(5, hybrid_xor_bytes(i));
+}
+
+template <size_t I>
+using HyIV = ItemValIdx<hybrid_head_bytes(I), (size_t(1) << I) * EquihashParams::kIndexBytes>;
+template <size_t I>
+using HyItem = ItemVal<hybrid_xor_bytes(I)>;
+template <size_t I>
+using HyItemIDX = ItemValIdx<hybrid_xor_bytes(I), EquihashParams::kIndexBytes>;
+
+// Pair of index vectors emitted by the recomputed IP{h1+1}.
+template <size_t I>
+struct HyIVPair
+{
+    uint8_t index[2 * (size_t(1) << I) * EquihashParams::kIndexBytes];
+};
+
+// ------------------ Leaf rehashing ------------------
+struct HyLeafHasher
+{
+    LeafGenerator G;
+
+    // XOR of the `count` leaves listed in `idx`, shifted down by `shift`
+    // bits, into out[0, len).
+    void xor_shifted(const uint8_t *idx, size_t count, size_t shift, uint8_t *out, size_t len) const
+    {
+        constexpr size_t LB = EquihashParams::kLayer0XorBytes;
+        constexpr size_t LPH = EquihashParams::kLeavesPerHash;
+        constexpr size_t IB = EquihashParams::kIndexBytes;
+        uint8_t acc[LB + 2] = {};
+        uint8_t h[LeafGenerator::OUT_LEN];
+        for (size_t c = 0; c < count; ++c)
+        {
+            uint32_t leaf = 0;
+            for (size_t t = 0; t < IB; ++t)
+                leaf |= static_cast<uint32_t>(idx[c * IB + t]) << (8 * t);
+            G.hash_index(static_cast<uint32_t>(leaf / LPH), h);
+            const uint8_t *x = h + (leaf % LPH) * LB;
+            for (size_t t = 0; t < LB; ++t)
+                acc[t] ^= x[t];
+        }
+        acc[LB - 1] &= EquihashParams::kLeafTopMask;
+        const size_t by = shift / 8, bt = shift % 8;
+        for (size_t t = 0; t < len; ++t)
+            out[t] = static_cast<uint8_t>((acc[by + t] >> bt) | (bt ? acc[by + t + 1] << (8 - bt) : 0));
+    }
+};
+
+// merge_func is a plain function pointer, so the seed of the run in
+// progress lives here.
+inline HyLeafHasher &hybrid_leaves()
+{
+    static HyLeafHasher hasher;
+    return hasher;
+}
+
+// ------------------ Merge helpers ------------------
+template <size_t I>
+struct HyStep
+{
+    static constexpr bool kLast = I + 1 == EquihashParams::K;
+    static constexpr size_t kKeyBits = (kLast ? 2 : 1) * EquihashParams::kCollisionBitLength;
+    using Key = std::conditional_t<(kKeyBits <= 32), uint32_t, uint64_t>;
+};
+
+template <typename T, size_t I>
+inline typename HyStep<I>::Key hybrid_key(const T &item)
+{
+    return get_key_bits<T, HyStep<I>::kKeyBits>(item);
+}
+
+template <typename T, size_t I>
+inline void hybrid_sort(LayerVec<T> &layer)
+{
+    sort_layer_by_key<T, HyStep<I>::kKeyBits>(layer);
+}
+
+template <size_t I, typename T>
+inline constexpr bool (*hybrid_zero_fn)(const T &) =
+    HyStep<I>::kLast ? static_cast<bool (*)(const T &)>(nullptr) : &is_zero_item<T>;
+
+// Index vectors I -> I+1: concatenate, rehash the 2^(I+1) leaves for the head.
+template <size_t I>
+inline HyIV<I + 1> hybrid_merge_iv(const HyIV<I> &a, const HyIV<I> &b)
+{
+    HyIV<I + 1> out;
+    std::memcpy(out.index, a.index, sizeof(a.index));
+    std::memcpy(out.index + sizeof(a.index), b.index, sizeof(b.index));
+    hybrid_leaves().xor_shifted(out.index, size_t(1) << (I + 1),
+                                (I + 1) * EquihashParams::kCollisionBitLength, out.XOR, sizeof(out.XOR));
+    return out;
+}
+
+// Last index-vector layer h1 -> h1+1: the full XOR, no indices.
+template <size_t I>
+inline HyItem<I + 1> hybrid_merge_iv_out(const HyIV<I> &a, const HyIV<I> &b)
+{
+    HyIVPair<I> p;
+    std::memcpy(p.index, a.index, sizeof(a.index));
+    std::memcpy(p.index + sizeof(a.index), b.index, sizeof(b.index));
+    HyItem<I + 1> out;
+    hybrid_leaves().xor_shifted(p.index, size_t(1) << (I + 1),
+                                (I + 1) * EquihashParams::kCollisionBitLength, out.XOR, sizeof(out.XOR));
+    return out;
+}
+
+template <size_t I>
+inline HyIVPair<I> hybrid_iv_pair(const HyIV<I> &a, const HyIV<I> &b)
+{
+    HyIVPair<I> p;
+    std::memcpy(p.index, a.index, sizeof(a.index));
+    std::memcpy(p.index + sizeof(a.index), b.index, sizeof(b.index));
+    return p;
+}
+
+template <size_t I>
+inline HyItem<I + 1> hybrid_merge_item(const HyItem<I> &a, const HyItem<I> &b)
+{
+    return merge_item_generic<HyItem<I>, HyItem<I + 1>>(a, b, static_cast<int>(EquihashParams::kCollisionBitLength));
+}
+
+template <size_t I>
+inline HyItemIDX<I + 1> hybrid_merge_item_idx(const HyItemIDX<I> &a, const HyItemIDX<I> &b)
+{
+    return merge_item_generic<HyItemIDX<I>, HyItemIDX<I + 1>>(a, b, static_cast<int>(EquihashParams::kCollisionBitLength));
+}
+
+// ------------------ Forward pass ------------------
+struct HybridPass
+{
+    size_t h1;
+    size_t stop;   // last layer built; handed to the callback indexed (or as index vectors when == h1)
+    uint8_t *base;
+    size_t arena_bytes;
+};
+
+// In-place merge whose items may grow: the source moves to the end of the
+// arena first and the gap in front of it is head room for the output.
+// Outputs are capped at MAX_LIST_SIZE in every pass, so positions agree.
+template <typename Src, typename Dst,
+          Dst (*merge_fn)(const Src &, const Src &), size_t I>
+inline LayerVec<Dst> hybrid_merge_grow(LayerVec<Src> &src, const HybridPass &p)
+{
+    const size_t n = src.size();
+    uint8_t *at = p.base;
+    if constexpr (sizeof(Dst) > sizeof(Src))
+    {
+        at = p.base + p.arena_bytes - n * sizeof(Src);
+        std::memmove(at, p.base, n * sizeof(Src));
+    }
+    auto moved = init_layer<Src>(at, n * sizeof(Src));
+    moved.resize(n);
+    auto dst = init_layer<Dst>(p.base, EquihashParams::kMaxListSize * sizeof(Dst));
+    merge_inplace_generic<Src, Dst, merge_fn, &hybrid_sort<Src, I>, true,
+                          typename HyStep<I>::Key, &hybrid_key<Src, I>, &is_zero_item<Dst>>(
+        moved, dst, static_cast<size_t>(at - p.base));
+    if (g_verbose)
+    {
+        std::cout << "Layer " << I + 1 << " size: " << dst.size() << std::endl;
+    }
+    return dst;
+}
+
+// XOR-only layers from h1+1 up to `stop`, which is indexed for `last`.
+template <size_t I, typename Last>
+inline void hybrid_forward_items(LayerVec<HyItem<I>> &S, const HybridPass &p, Last &&last)
+{
+    if (I == p.stop)
+    {
+        auto S_IDX = expand_layer_to_idx_inplace<HyItem<I>, HyItemIDX<I>>(S);
+        last(S_IDX, std::integral_constant<size_t, I>{});
+        return;
+    }
+    if constexpr (I + 1 < EquihashParams::K)
+    {
+        auto D = init_layer<HyItem<I + 1>>(p.base, EquihashParams::kMaxListSize * sizeof(HyItem<I + 1>));
+        merge_inplace_generic<HyItem<I>, HyItem<I + 1>, hybrid_merge_item<I>, &hybrid_sort<HyItem<I>, I>, true,
+                              typename HyStep<I>::Key, &hybrid_key<HyItem<I>, I>, &is_zero_item<HyItem<I + 1>>>(S, D);
+        if (g_verbose)
+        {
+            std::cout << "Layer " << I + 1 << " size: " << D.size() << std::endl;
+        }
+        hybrid_forward_items<I + 1>(D, p, last);
+    }
+}
+
+// Index-vector layers 0..h1. At `stop` == h1 the layer goes to `last_iv`,
+// otherwise to the XOR-only part.
+template <size_t I, typename LastIV, typename Last>
+inline void hybrid_forward_iv(LayerVec<HyIV<I>> &S, const HybridPass &p, LastIV &&last_iv, Last &&last)
+{
+    if (I == p.h1)
+    {
+        if (p.stop == I)
+        {
+            last_iv(S, std::integral_constant<size_t, I>{});
+            return;
+        }
+        if constexpr (I + 1 < EquihashParams::K)
+        {
+            auto D = hybrid_merge_grow<HyIV<I>, HyItem<I + 1>, hybrid_merge_iv_out<I>, I>(S, p);
+            hybrid_forward_items<I + 1>(D, p, last);
+        }
+        return;
+    }
+    if constexpr (I + 2 < EquihashParams::K)
+    {
+        auto D = hybrid_merge_grow<HyIV<I>, HyIV<I + 1>, hybrid_merge_iv<I>, I>(S, p);
+        hybrid_forward_iv<I + 1>(D, p, last_iv, last);
+    }
+}
+
+template <typename LastIV, typename Last>
+inline void hybrid_forward(int seed, const HybridPass &p, LastIV &&last_iv, Last &&last)
+{
+    hybrid_leaves().G.init_seed(static_cast<uint32_t>(seed));
+    auto L0 = init_layer<HyIV<0>>(p.base, p.arena_bytes);
+    for_each_leaf(seed, [&](size_t leaf, const uint8_t *x)
+                  {
+                      HyIV<0> item;
+                      std::memcpy(item.XOR, x, sizeof(item.XOR));
+                      set_index(item, leaf);
+                      L0.push_back(item); });
+    hybrid_forward_iv<0>(L0, p, last_iv, last);
+}
+
+// Indexed layers from h2: IP{I+1} goes to ram_ips[I - h2] below the end of
+// the arena, IP{K} to `ip_last`, a layer over the front of the arena.
+template <size_t I>
+inline void hybrid_forward_idx(LayerVec<HyItemIDX<I>> &S, size_t h2, uint8_t *base, uint8_t *end,
+                               std::vector<Layer_IP> &ram_ips, Layer_IP &ip_last)
+{
+    using Step = HyStep<I>;
+    if constexpr (Step::kLast)
+    {
+        merge_inplace_for_ip_generic<HyItemIDX<I>, HyItemIDX<I + 1>, Item_IP,
+                                     hybrid_merge_item_idx<I>, &hybrid_sort<HyItemIDX<I>, I>, false,
+                                     typename Step::Key, &hybrid_key<HyItemIDX<I>, I>, nullptr,
+                                     &make_ip_pair<HyItemIDX<I>, Item_IP>, true>(S, ip_last);
+    }
+    else
+    {
+        const uint64_t ip_bytes = EquihashParams::kMaxListSize * sizeof(Item_IP);
+        ram_ips.push_back(init_layer<Item_IP>(end - (I + 1 - h2) * ip_bytes, ip_bytes));
+        auto D = init_layer<HyItemIDX<I + 1>>(base, EquihashParams::kMaxListSize * sizeof(HyItemIDX<I + 1>));
+        merge_ip_inplace_generic<HyItemIDX<I>, HyItemIDX<I + 1>, Item_IP,
+                                 hybrid_merge_item_idx<I>, &hybrid_sort<HyItemIDX<I>, I>, true,
+                                 typename Step::Key, &hybrid_key<HyItemIDX<I>, I>, &is_zero_item<HyItemIDX<I + 1>>,
+                                 &make_ip_pair<HyItemIDX<I>, Item_IP>, false>(S, D, ram_ips.back());
+        set_index_batch(D);
+        if (g_verbose)
+        {
+            std::cout << "Layer " << I + 1 << " size: " << D.size() << " (IP in RAM)" << std::endl;
+        }
+        hybrid_forward_idx<I + 1>(D, h2, base, end, ram_ips, ip_last);
+    }
+}
+
+// ------------------ Memory ------------------
+// Item bytes of layer i as the hybrid stores it.
+template <size_t... I>
+inline std::vector<size_t> hybrid_iv_sizes(std::index_sequence<I...>)
+{
+    return {sizeof(HyIV<I>)...};
+}
+
+template <size_t... I>
+inline std::vector<size_t> hybrid_idx_sizes(std::index_sequence<I...>)
+{
+    return {sizeof(HyItemIDX<I>)...};
+}
+
+// Recomputation up to layer j holds one layer at a time (index vectors up
+// to h1, then indexed XORs at worst); the main pass then adds the RAM IP
+// layers below the indexed layer they are produced from.
+inline uint64_t hybrid_arena_bytes(size_t h1, size_t h2)
+{
+    constexpr size_t K = EquihashParams::K;
+    const uint64_t list = EquihashParams::kMaxListSize;
+    const uint64_t ip = list * sizeof(Item_IP);
+    const std::vector<size_t> iv = hybrid_iv_sizes(std::make_index_sequence<K>{});
+    const std::vector<size_t> idx = hybrid_idx_sizes(std::make_index_sequence<K>{});
+
+    uint64_t peak = 0;
+    for (size_t i = 0; i <= h1; ++i)
+        peak = std::max(peak, list * iv[i]);
+    for (size_t i = h1 + 1; i < K; ++i)
+        peak = std::max(peak, list * idx[i]);
+    for (size_t i = h2; i < K; ++i)
+        peak = std::max(peak, list * idx[i] + (i + 1 < K ? i + 1 - h2 : K - 1 - h2) * ip);
+    return std::max(peak, ip + (K - 1 - h2) * ip);
+}
+
+// ------------------ Solver ------------------
+// Expand `solutions` (refs into layer j) through the recomputed IP{j}.
+inline void hybrid_recover_and_expand(SolutionSet &solutions, int seed, size_t h1, size_t j,
+                                      uint8_t *base, size_t arena_bytes)
+{
+    const std::vector<size_t> wanted = solution_refs(solutions);
+    std::vector<Item_IP> pairs;
+    size_t emitted = 0;
+    const HybridPass p{h1, j - 1, base, arena_bytes};
+    hybrid_forward(seed, p, [](auto &, auto) {}, [&](auto &S, auto layer)
+                   {
+                       constexpr size_t I = decltype(layer)::value;
+                       using Src = typename std::decay_t<decltype(S)>::value_type;
+                       emitted = merge_for_ip_sparse_generic<Src, HyItemIDX<I + 1>, Item_IP,
+                                                             hybrid_merge_item_idx<I>, &hybrid_sort<Src, I>, !HyStep<I>::kLast,
+                                                             typename HyStep<I>::Key, &hybrid_key<Src, I>,
+                                                             hybrid_zero_fn<I, HyItemIDX<I + 1>>,
+                                                             &make_ip_pair<Src, Item_IP>, HyStep<I>::kLast>(
+                           S, EquihashParams::kMaxListSize, wanted, pairs); });
+    if (g_verbose)
+    {
+        std::cout << "Layer " << j << " IP pairs emitted: " << emitted << ", kept: " << pairs.size() << std::endl;
+    }
+    expand_solutions_sparse(solutions, wanted, pairs);
+}
+
+// Replace the refs into layer h1+1 by their leaves: recompute IP{h1+1}
+// from the index vectors of layer h1.
+template <size_t I>
+inline SolutionSet hybrid_expand_leaves(const SolutionSet &solutions, int seed, uint8_t *base, size_t arena_bytes)
+{
+    constexpr size_t IB = EquihashParams::kIndexBytes;
+    constexpr size_t PAIR_LEAVES = size_t(2) << I;
+    const std::vector<size_t> wanted = solution_refs(solutions);
+    std::vector<HyIVPair<I>> pairs;
+    const HybridPass p{I, I, base, arena_bytes};
+    hybrid_forward(seed, p, [&](auto &S, auto layer)
+                   {
+                       if constexpr (decltype(layer)::value == I)
+                           merge_for_ip_sparse_generic<HyIV<I>, HyItem<I + 1>, HyIVPair<I>,
+                                                       hybrid_merge_iv_out<I>, &hybrid_sort<HyIV<I>, I>, true,
+                                                       typename HyStep<I>::Key, &hybrid_key<HyIV<I>, I>,
+                                                       &is_zero_item<HyItem<I + 1>>, &hybrid_iv_pair<I>, false>(
+                               S, EquihashParams::kMaxListSize, wanted, pairs); },
+                   [](auto &, auto) {});
+
+    SolutionSet out;
+    std::vector<uint32_t> sol(out.stride());
+    for (size_t s = 0; s < solutions.size(); ++s)
+    {
+        const uint32_t *refs = solutions[s];
+        bool ok = true;
+        for (size_t r = 0; r < solutions.width() && ok; ++r)
+        {
+            const size_t k = std::lower_bound(wanted.begin(), wanted.end(), refs[r]) - wanted.begin();
+            ok = k < pairs.size() && wanted[k] == refs[r];
+            for (size_t l = 0; l < PAIR_LEAVES && ok; ++l)
+            {
+                uint32_t v = 0;
+                for (size_t t = 0; t < IB; ++t)
+                    v |= static_cast<uint32_t>(pairs[k].index[l * IB + t]) << (8 * t);
+                sol[r * PAIR_LEAVES + l] = v;
+            }
+        }
+        if (ok)
+            out.push_full(sol.data());
+    }
+    out.drop_trivial();
+    return out;
+}
+
+template <size_t I>
+inline SolutionSet hybrid_expand_leaves_at(size_t h1, const SolutionSet &solutions, int seed, uint8_t *base, size_t arena_bytes)
+{
+    if (I == h1)
+        return hybrid_expand_leaves<I>(solutions, seed, base, arena_bytes);
+    if constexpr (I + 2 < EquihashParams::K)
+        return hybrid_expand_leaves_at<I + 1>(h1, solutions, seed, base, arena_bytes);
+    else
+        return {};
+}
+
+inline SolutionSet hybrid_solve(int seed, size_t h1, size_t h2, uint8_t *base, size_t arena_bytes)
+{
+    constexpr size_t K = EquihashParams::K;
+    assert(h1 < h2 && h2 < K && "hybrid needs 0 <= h1 < h2 <= K-1");
+
+    std::vector<Layer_IP> ram_ips;
+    ram_ips.reserve(K);
+    Layer_IP ip_last = init_layer<Item_IP>(base, EquihashParams::kMaxListSize * sizeof(Item_IP));
+    const HybridPass p{h1, h2, base, arena_bytes};
+    hybrid_forward(seed, p, [](auto &, auto) {}, [&](auto &S, auto layer)
+                   { hybrid_forward_idx<decltype(layer)::value>(S, h2, base, base + arena_bytes, ram_ips, ip_last); });
+    if (g_verbose)
+    {
+        std::cout << "Layer " << K << " IP size: " << ip_last.size() << std::endl;
+    }
+
+    SolutionSet solutions;
+    expand_solutions(solutions, ip_last);
+    for (size_t j = K - 1; j > h2 && !solutions.empty(); --j)
+        expand_solutions(solutions, ram_ips[j - 1 - h2]);
+    for (size_t j = h2; j > h1 + 1 && !solutions.empty(); --j)
+        hybrid_recover_and_expand(solutions, seed, h1, j, base, arena_bytes);
+    if (solutions.empty())
+        return solutions;
+    solutions.drop_trivial();
+    return hybrid_expand_leaves_at<0>(h1, solutions, seed, base, arena_bytes);
+}
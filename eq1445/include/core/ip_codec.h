@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "core/equihash_base.h"
+
+// ============================================================================
+// Block codec for on-disk IP layers
+// ============================================================================
+//
+// Pairs emitted by one collision group reuse the group's members, e.g. a group
+// {a, b, c} yields (a,b) (a,c) (b,c), so an index very often equals one of the
+// last few distinct indices seen. Each index is coded as
+//
+//   1 | slot (2 bits)        hit in a 4-entry move-to-front window, or
+//   0 | value (width bits)   literal, width = bit width of the block maximum.
+//
+// A block starts with one byte holding `width` and resets the window, so any
+// block can be decoded on its own. The item count of a block is not stored;
+// it comes from the block index kept next to the layer manifest.
+
+namespace equihash
+{
+
+template <typename ItemIP>
+struct IPBlockCodec
+{
+    static constexpr std::size_t kIndexBytes = sizeof(std::declval<ItemIP &>().index_pointer_left);
+    static constexpr unsigned kWindow = 4; // Window::find/promote are unrolled for 4 slots
+    static constexpr unsigned kSlotBits = 2;
+    static_assert(kIndexBytes <= 7, "a literal plus its flag must fit in 57 bits");
+
+    // Upper bound on the encoded size of `n` pairs (including decoder slack).
+    static constexpr std::size_t max_encoded_bytes(std::size_t n)
+    {
+        return 1 + (n * 2 * (1 + kIndexBytes * 8) + 7) / 8 + 8;
+    }
+
+    static std::size_t encode(const ItemIP *in, std::size_t n, uint8_t *out)
+    {
+        uint64_t max_v = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const uint64_t l = load(in[i].index_pointer_left);
+            const uint64_t r = load(in[i].index_pointer_right);
+            max_v |= l | r;
+        }
+        unsigned width = 1;
+        while (width < 64 && (max_v >> width) != 0)
+            ++width;
+
+        out[0] = static_cast<uint8_t>(width);
+        BitWriter bw{out + 1};
+        Window win;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            put(bw, win, load(in[i].index_pointer_left), width);
+            put(bw, win, load(in[i].index_pointer_right), width);
+        }
+        return 1 + bw.finish();
+    }
+
+    // Decode `n` pairs from a block produced by `encode`.
+    static void decode(const uint8_t *in, std::size_t n, ItemIP *out)
+    {
+        const unsigned width = in[0];
+        BitReader br{in + 1};
+        Window win;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            store(out[i].index_pointer_left, get(br, win, width));
+            store(out[i].index_pointer_right, get(br, win, width));
+        }
+    }
+
+private:
+    struct Window
+    {
+        uint64_t v[kWindow] = {~0ull, ~0ull, ~0ull, ~0ull};
+
+        // Slot holding `x`, or kWindow when absent (branch-free).
+        inline unsigned find(uint64_t x) const
+        {
+            const unsigned m = (unsigned(v[0] == x) << 0) | (unsigned(v[1] == x) << 1) |
+                               (unsigned(v[2] == x) << 2) | (unsigned(v[3] == x) << 3) | (1u << kWindow);
+            return static_cast<unsigned>(__builtin_ctz(m));
+        }
+        // Shift slots [0, s) down by one and put `x` in front; s = kWindow - 1
+        // evicts the oldest entry.
+        inline void promote(unsigned s, uint64_t x)
+        {
+            const uint64_t v0 = v[0], v1 = v[1], v2 = v[2];
+            v[3] = (s >= 3) ? v2 : v[3];
+            v[2] = (s >= 2) ? v1 : v2;
+            v[1] = (s >= 1) ? v0 : v1;
+            v[0] = x;
+        }
+    };
+
+    // Appends up to 57 bits per call to a 64-bit accumulator.
+    struct BitWriter
+    {
+        uint8_t *p;
+        uint64_t acc = 0;
+        unsigned nbits = 0;
+        std::size_t bytes = 0;
+
+        inline void put(uint64_t x, unsigned bits)
+        {
+            acc |= x << nbits;
+            nbits += bits;
+            if (nbits >= 64)
+            {
+                std::memcpy(p + bytes, &acc, 8);
+                bytes += 8;
+                nbits -= 64;
+                acc = nbits ? (x >> (bits - nbits)) : 0;
+            }
+        }
+        inline std::size_t finish()
+        {
+            const std::size_t tail = (nbits + 7) / 8;
+            std::memcpy(p + bytes, &acc, tail);
+            return bytes + tail;
+        }
+    };
+
+    // Peeks 57+ bits with one unaligned 8-byte load; callers keep 8 bytes of
+    // readable slack after each block.
+    struct BitReader
+    {
+        const uint8_t *p;
+        std::size_t bitpos = 0;
+
+        inline uint64_t peek() const
+        {
+            uint64_t w;
+            std::memcpy(&w, p + (bitpos >> 3), 8);
+            return w >> (bitpos & 7);
+        }
+        inline void skip(unsigned bits) { bitpos += bits; }
+    };
+
+    static inline void put(BitWriter &bw, Window &win, uint64_t x, unsigned width)
+    {
+        const unsigned s = win.find(x);
+        const bool hit = s < kWindow;
+        const uint64_t code = hit ? (1u | (s << 1)) : (x << 1);
+        bw.put(code, hit ? 1 + kSlotBits : 1 + width);
+        win.promote(hit ? s : kWindow - 1, x);
+    }
+
+    static inline uint64_t get(BitReader &br, Window &win, unsigned width)
+    {
+        const uint64_t w = br.peek();
+        if (w & 1)
+        {
+            const unsigned s = static_cast<unsigned>((w >> 1) & ((1u << kSlotBits) - 1));
+            br.skip(1 + kSlotBits);
+            const uint64_t x = win.v[s];
+            win.promote(s, x);
+            return x;
+        }
+        const uint64_t x = (w >> 1) & ((1ull << width) - 1);
+        br.skip(1 + width);
+        win.promote(kWindow - 1, x);
+        return x;
+    }
+
+    static inline uint64_t load(const uint8_t (&b)[kIndexBytes])
+    {
+        uint64_t v = 0;
+        for (std::size_t i = 0; i < kIndexBytes; ++i)
+            v |= static_cast<uint64_t>(b[i]) << (8 * i);
+        return v;
+    }
+
+    static inline void store(uint8_t (&b)[kIndexBytes], uint64_t v)
+    {
+        for (std::size_t i = 0; i < kIndexBytes; ++i)
+            b[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+};
+
+} // namespace equihash
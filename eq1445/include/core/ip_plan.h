@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ------------------ Per-layer IP placement plan ------------------
+// Where each IP layer IP1..IP{K-1} lives between the forward pass and the
+// solution expansion. IP{K} is always produced in RAM by the last merge.
+//
+//   RAM        kept in the arena (advanced_cip_pr above the switching height)
+//   SPILL      written to the EM store (cip_em)
+//   RECOMPUTE  rebuilt with recover_IP during expansion (below the height)
+//
+// A switching height h is the plan r^h m^(K-1-h); cip_em is d^(K-1).
+enum class IPPolicy : uint8_t
+{
+    RAM,
+    SPILL,
+    RECOMPUTE
+};
+
+// plan[j] is the policy of IP layer j+1.
+using IPPlan = std::vector<IPPolicy>;
+
+inline char ip_policy_char(IPPolicy p)
+{
+    switch (p)
+    {
+    case IPPolicy::RAM:
+        return 'm';
+    case IPPolicy::SPILL:
+        return 'd';
+    case IPPolicy::RECOMPUTE:
+        return 'r';
+    }
+    return '?';
+}
+
+// Parse one character per layer, lowest layer first: m = RAM, d = disk
+// (spill), r = recompute. Returns false on a bad character or length.
+inline bool parse_ip_plan(const std::string &s, size_t layers, IPPlan &out)
+{
+    if (s.size() != layers)
+        return false;
+    IPPlan plan;
+    plan.reserve(layers);
+    for (char c : s)
+    {
+        switch (c)
+        {
+        case 'm':
+        case 'M':
+            plan.push_back(IPPolicy::RAM);
+            break;
+        case 'd':
+        case 'D':
+            plan.push_back(IPPolicy::SPILL);
+            break;
+        case 'r':
+        case 'R':
+            plan.push_back(IPPolicy::RECOMPUTE);
+            break;
+        default:
+            return false;
+        }
+    }
+    out.swap(plan);
+    return true;
+}
+
+inline std::string format_ip_plan(const IPPlan &plan)
+{
+    std::string s;
+    for (IPPolicy p : plan)
+        s.push_back(ip_policy_char(p));
+    return s;
+}
+
+inline IPPlan ip_plan_for_switching_height(int h, size_t layers)
+{
+    IPPlan plan(layers, IPPolicy::RAM);
+    for (size_t j = 0; j < layers && static_cast<int>(j) < h; ++j)
+        plan[j] = IPPolicy::RECOMPUTE;
+    return plan;
+}
+
+// Lowest IP layer (1-based) that is not recomputed, or layers+1 if none.
+// Item layers below it can run without indices.
+inline size_t ip_plan_lowest_kept(const IPPlan &plan)
+{
+    for (size_t j = 0; j < plan.size(); ++j)
+        if (plan[j] != IPPolicy::RECOMPUTE)
+            return j + 1;
+    return plan.size() + 1;
+}
+
+inline bool ip_plan_has(const IPPlan &plan, IPPolicy p)
+{
+    for (IPPolicy q : plan)
+        if (q == p)
+            return true;
+    return false;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "core/zcash_blake.h"
+
+#ifdef NBLAKES
+extern "C" {
+#include "blake2bip.h"  // For 4-way Blake2b
+}
+#endif
+
+// ------------------ Leaf generators ------------------
+// Requires EquihashParams from the including translation unit.
+//
+// Everything that needs leaves (fill_layer0, compute_ith_item, recovery,
+// the verifier, the hybrid rehash) gets them from LeafGenerator, picked at
+// compile time with -DLEAF_GENERATOR=<type>. A generator maps a seed and a
+// hash index to OUT_LEN bytes holding kLeavesPerHash leaves, and must be
+// random access: recovery and verification hash single indices.
+//
+//   static constexpr size_t OUT_LEN;  // bytes per output (>= LPH * leaf bytes)
+//   static constexpr size_t BATCH;    // outputs per hash_batch
+//   static constexpr size_t STRIDE;   // distance between batch outputs
+//   void init_seed(uint32_t seed);
+//   void hash_index(uint32_t idx, uint8_t *out) const;
+//   void hash_batch(uint32_t first, uint8_t *out) const;  // first % BATCH == 0
+//
+// Bits above N in a leaf's top byte are cleared by the callers.
+
+template <size_t>
+inline constexpr bool kLeafGenUnsupported = false;
+
+// Equihash BLAKE2b over ZcashEquihashHasher, so the personalization
+// (EQ_PERSONAL) and the block header (g_header) apply. Lanes 4 and 8 use
+// blake2bip and need an NBLAKES build.
+template <size_t Lanes>
+struct Blake2bLeafGen
+{
+    static constexpr size_t OUT_LEN = ZcashEquihashHasher::OUT_LEN;
+    static constexpr size_t BATCH = Lanes;
+    static constexpr size_t STRIDE = Lanes == 1 ? OUT_LEN : 64;  // blake2bip writes whole digests
+
+    ZcashEquihashHasher H;
+
+    void init_seed(uint32_t seed) { H.init_seed(seed); }
+
+    void hash_index(uint32_t idx, uint8_t *out) const { H.hash_index(idx, out); }
+
+    void hash_batch(uint32_t first, uint8_t *out) const
+    {
+        if constexpr (Lanes == 1)
+            H.hash_index(first, out);
+#ifdef NBLAKES
+        else if constexpr (Lanes == 4)
+            blake2bx4_final(&H.mid_, out, first / 4);
+        else if constexpr (Lanes == 8)
+            blake2bx8_final(&H.mid_, out, first / 8);
+#endif
+        else
+            static_assert(kLeafGenUnsupported<Lanes>, "Blake2bLeafGen lanes: 1, or 4 and 8 with NBLAKES");
+    }
+};
+
+// Counter-based PRNG for synthetic instances: output word j of index i is
+// the SplitMix64 finalizer of key + (i * WORDS + j) * golden ratio. Random
+// access like BLAKE2b, unlike fill_layer_from_mt, at a fraction of the cost;
+// ignores g_header.
+struct CounterLeafGen
+{
+    static constexpr size_t OUT_LEN = EquihashParams::kHashOutputBytes;
+    static constexpr size_t WORDS = (OUT_LEN + 7) / 8;
+    static constexpr size_t BATCH = 8;
+    static constexpr size_t STRIDE = WORDS * 8;
+
+    uint64_t key_ = 0;
+
+    static uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    void init_seed(uint32_t seed) { key_ = mix(0x9E3779B97F4A7C15ull * (uint64_t(seed) + 1)); }
+
+    void hash_index(uint32_t idx, uint8_t *out) const
+    {
+        uint64_t w[WORDS];
+        for (size_t j = 0; j < WORDS; ++j)
+            w[j] = mix(key_ + (uint64_t(idx) * WORDS + j) * 0x9E3779B97F4A7C15ull);
+        std::memcpy(out, w, OUT_LEN);
+    }
+
+    void hash_batch(uint32_t first, uint8_t *out) const
+    {
+        for (size_t lane = 0; lane < BATCH; ++lane)
+            hash_index(first + static_cast<uint32_t>(lane), out + lane * STRIDE);
+    }
+};
+
+#ifndef LEAF_GENERATOR
+#if defined(NBLAKES) && NBLAKES == 8
+#define LEAF_GENERATOR Blake2bLeafGen<8>
+#elif defined(NBLAKES)
+#define LEAF_GENERATOR Blake2bLeafGen<4>
+#else
+#define LEAF_GENERATOR Blake2bLeafGen<1>
+#endif
+#endif
+
+using LeafGenerator = LEAF_GENERATOR;
+
+static_assert(LeafGenerator::OUT_LEN >= EquihashParams::kLeavesPerHash * EquihashParams::kLayer0XorBytes,
+              "LeafGenerator output too short for kLeavesPerHash leaves");
+static_assert(LeafGenerator::STRIDE >= LeafGenerator::OUT_LEN, "LeafGenerator batch outputs overlap");
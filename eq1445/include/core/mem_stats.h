@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// Measure peak RSS (kB)
+static long peak_rss_kb()
+{
+    // Use Linux /proc/self/status
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f)
+        return -1;
+    char line[512];
+    long kb = -1;
+    while (fgets(line, sizeof(line), f))
+    {
+        if (std::strncmp(line, "VmHWM:", 6) == 0)
+        {
+            char *p = std::strrchr(line, '\t');
+            if (!p)
+                p = line;
+            long v = 0;
+            if (sscanf(line + 6, "%ld", &v) == 1)
+            {
+                kb = v;
+                break;
+            }
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+// Measure current USS (Unique Set Size) in kilobytes.
+// This reads /proc/self/smaps_rollup and sums Private_Dirty and Private_Clean
+// which approximates the process' private RSS (USS). If smaps_rollup is not
+// available, fall back to VmRSS from /proc/self/status (less precise).
+static inline long current_uss_kb()
+{
+    // Prefer smaps_rollup when available (aggregated per-process values).
+    FILE *f = fopen("/proc/self/smaps_rollup", "r");
+    if (f)
+    {
+        char line[256];
+        long private_dirty = 0;
+        long private_clean = 0;
+        while (fgets(line, sizeof(line), f))
+        {
+            if (std::strncmp(line, "Private_Dirty:", 14) == 0)
+            {
+                long v = 0;
+                if (sscanf(line + 14, "%ld", &v) == 1)
+                    private_dirty += v;
+            }
+            else if (std::strncmp(line, "Private_Clean:", 14) == 0)
+            {
+                long v = 0;
+                if (sscanf(line + 14, "%ld", &v) == 1)
+                    private_clean += v;
+            }
+        }
+        fclose(f);
+        return private_dirty + private_clean;
+    }
+    // cannot read, error
+    std::cerr << "Warning: cannot open /proc/self/smaps_rollup for USS measurement, falling back to VmRSS\n";
+    return -1;
+}
+
+static inline void debug_print_uss(const char *tag)
+{
+    long kb = current_uss_kb();
+    std::cout << "[USS] " << tag << " USS=" << kb << " kB\n";
+}
+
+static inline void debug_print_rss(const char *tag)
+{
+    size_t kb = peak_rss_kb();
+    std::cout << "[RSS] " << tag << " VmRSS=" << kb << " kB\n";
+}
@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "core/equihash_base.h"
+#include "core/em_store.h"
 
 // Merge tuning knobs (can be overridden per benchmark/test when needed)
 #ifndef MOVE_BOUND
@@ -247,14 +248,19 @@ inline void merge_ip_inplace_generic(LayerVec<SrcItem> &src_arr,
 
 // ------------------ Merge (in-place) without IP capture ------------------
 // `src_arr` and `dst_arr` share the same memory region for memory-efficiency.
+// `head_room` bytes in front of `src_arr` are free for `dst_arr` from the
+// start (src placed at the end of the region, for items that grow). Outputs
+// rejected by `keep_func` are dropped.
 template <typename SrcItem, typename DstItem,
           DstItem (*merge_func)(const SrcItem &, const SrcItem &),
           void (*sort_func)(LayerVec<SrcItem> &), bool discard_zero,
           typename KeyType, KeyType (*key_func)(const SrcItem &),
           bool (*is_zero_func)(const DstItem &) = nullptr,
-          bool is_last = false>
+          bool is_last = false,
+          bool (*keep_func)(const DstItem &) = nullptr>
 inline void merge_inplace_generic(LayerVec<SrcItem> &src_arr,
-                                  LayerVec<DstItem> &dst_arr)
+                                  LayerVec<DstItem> &dst_arr,
+                                  size_t head_room = 0)
 {
     static_assert(key_func != nullptr, "Key extractor must be provided");
     static_assert(!discard_zero || is_zero_func != nullptr,
@@ -270,7 +276,7 @@ inline void merge_inplace_generic(LayerVec<SrcItem> &src_arr,
     std::vector<uint8_t> skip_buf;
     tmp_items.reserve(MAX_TMP_SIZE);
     skip_buf.reserve(GROUP_BOUND);
-    size_t free_bytes = 0;
+    size_t free_bytes = head_room;
     size_t avail_dst = dst_arr.capacity() - dst_arr.size();
 
     size_t i = 0;
@@ -301,6 +307,11 @@ inline void merge_inplace_generic(LayerVec<SrcItem> &src_arr,
                         skip_buf[j2 - group_start] = 1;
                         continue;
                     }
+                    if constexpr (keep_func != nullptr)
+                    {
+                        if (!keep_func(out))
+                            continue;
+                    }
                     tmp_items.emplace_back(out);
                 }
             }
@@ -314,7 +325,13 @@ inline void merge_inplace_generic(LayerVec<SrcItem> &src_arr,
             for (size_t j1 = group_start; j1 < group_end; ++j1)
                 for (size_t j2 = j1 + 1; j2 < group_end; ++j2)
                 {
-                    tmp_items.emplace_back(merge_func(src_arr[j1], src_arr[j2]));
+                    DstItem out = merge_func(src_arr[j1], src_arr[j2]);
+                    if constexpr (keep_func != nullptr)
+                    {
+                        if (!keep_func(out))
+                            continue;
+                    }
+                    tmp_items.emplace_back(out);
                 }
         }
 
@@ -444,141 +461,122 @@ inline void merge_inplace_for_ip_generic(LayerVec<SrcItem> &src_arr,
     }
 }
 
-// external memory classes
-
-template <typename IPItem>
-class IPDiskWriter
+// ------------------ Merge: output only requested IPs ------------------
+// Emits pairs in the same order as merge_inplace_for_ip_generic into an IP
+// layer of `capacity` slots, but keeps only those at the sorted, unique
+// positions `wanted` (`out[k]` is the pair at `wanted[k]`); the others are
+// only counted. Stops once the last wanted pair is out. Returns the number
+// of pairs emitted.
+template <typename SrcItem, typename DstItem, typename IPItem,
+          DstItem (*merge_func)(const SrcItem &, const SrcItem &),
+          void (*sort_func)(LayerVec<SrcItem> &), bool discard_zero,
+          typename KeyType, KeyType (*key_func)(const SrcItem &),
+          bool (*is_zero_func)(const DstItem &) = nullptr,
+          IPItem (*make_ip_func)(const SrcItem &, const SrcItem &) = nullptr,
+          bool is_last = false>
+inline size_t merge_for_ip_sparse_generic(LayerVec<SrcItem> &src_arr, size_t capacity,
+                                          const std::vector<size_t> &wanted,
+                                          std::vector<IPItem> &out)
 {
-public:
-    std::FILE *f_;
-    uint64_t cursor_;
+    static_assert(key_func != nullptr, "Key extractor must be provided");
+    static_assert(!discard_zero || is_zero_func != nullptr,
+                  "Zero-check function required when discarding zeros");
+    static_assert(make_ip_func != nullptr,
+                  "IP construction callback must be provided");
+    out.clear();
+    out.reserve(wanted.size());
+    if (src_arr.empty() || wanted.empty())
+        return 0;
+    sort_func(src_arr);
+    const size_t N = src_arr.size();
+    std::vector<uint8_t> skip_buf;
+    skip_buf.reserve(GROUP_BOUND);
 
-    IPDiskWriter() : f_(nullptr), cursor_(0) {}
-    ~IPDiskWriter() { close(); }
-    bool open(const char *p)
-    {
-        close();
-        f_ = std::fopen(p, "wb");
-        cursor_ = 0;
-        return f_ != nullptr;
-    }
-    void close()
+    size_t pos = 0;  // position the next pair would take in the dense layer
+    size_t next = 0; // next entry of `wanted`
+    size_t i = 0;
+    while (i < N && pos < capacity && next < wanted.size())
     {
-        if (f_)
+        const size_t group_start = i;
+        const auto key0 = key_func(src_arr[group_start]);
+        i++;
+        while (i < N && key_func(src_arr[i]) == key0)
+            ++i;
+        const size_t group_end = i;
+        const size_t group_size = group_end - group_start;
+
+        if (discard_zero)
         {
-            std::fclose(f_);
-            f_ = nullptr;
+            skip_buf.assign(group_size, 0);
+            for (size_t j1 = group_start; j1 < group_end; ++j1)
+            {
+                if (skip_buf[j1 - group_start])
+                    continue;
+                for (size_t j2 = j1 + 1; j2 < group_end; ++j2)
+                {
+                    if (skip_buf[j2 - group_start])
+                        continue;
+                    if (is_zero_func(merge_func(src_arr[j1], src_arr[j2])))
+                    {
+                        skip_buf[j2 - group_start] = 1;
+                        continue;
+                    }
+                    if (next < wanted.size() && wanted[next] == pos)
+                    {
+                        out.emplace_back(make_ip_func(src_arr[j1], src_arr[j2]));
+                        ++next;
+                    }
+                    ++pos;
+                }
+            }
         }
-        cursor_ = 0;
-    }
-
-    uint64_t append_layer(const IPItem *data, size_t n)
-    {
-        if (!f_ || !n)
-            return cursor_;
-        size_t bytes = n * sizeof(IPItem);
-        size_t w = std::fwrite(data, 1, bytes, f_);
-        if (w != bytes)
-            std::perror("fwrite");
-        uint64_t off = cursor_;
-        cursor_ += w;
-        return off;
-    }
-
-    bool write_ip_item(const IPItem &item)
-    {
-        if (!f_)
-            return false;
-        size_t w = std::fwrite(&item, 1, sizeof(IPItem), f_);
-        if (w != sizeof(IPItem))
+        else
         {
-            std::perror("fwrite");
-            return false;
+            if (is_last && group_size > 3)
+            {
+                continue;
+            } // last hop: skip large groups only for final merge
+            for (size_t j1 = group_start; j1 < group_end; ++j1)
+                for (size_t j2 = j1 + 1; j2 < group_end; ++j2)
+                {
+                    if (next < wanted.size() && wanted[next] == pos)
+                    {
+                        out.emplace_back(make_ip_func(src_arr[j1], src_arr[j2]));
+                        ++next;
+                    }
+                    ++pos;
+                }
         }
-        cursor_ += w;
-        return true;
     }
+    // Pairs past `capacity` would have been dropped by the dense merge.
+    while (!out.empty() && wanted[out.size() - 1] >= capacity)
+        out.pop_back();
+    return pos;
+}
 
-    size_t get_current_offset() const
-    {
-        return cursor_;
-    }
-};
-
+// IP sink for a merge whose IP layer is not kept (it is recomputed later):
+// the destination items are still produced and indexed, the pairs dropped.
 template <typename IPItem>
-class IPDiskReader
+struct IPDiscardSink
 {
-public:
-    IPDiskReader() : f_(nullptr) {}
-    ~IPDiskReader() { close(); }
-    bool open(const char *p)
-    {
-        close();
-        f_ = std::fopen(p, "rb");
-        return f_ != nullptr;
-    }
-    void close()
-    {
-        if (f_)
-        {
-            std::fclose(f_);
-            f_ = nullptr;
-        }
-    }
-    bool read_slice(uint64_t off, uint32_t cnt, LayerVec<IPItem> &out)
-    {
-        if (!f_)
-            return false;
-        if (std::fseek(f_, (long)off, SEEK_SET) != 0)
-        {
-            std::perror("fseek");
-            return false;
-        }
-        out.resize(cnt);
-        size_t bytes = size_t(cnt) * sizeof(IPItem);
-        size_t r = std::fread(out.data(), 1, bytes, f_);
-        if (r != bytes)
-        {
-            std::perror("fread");
-            return false;
-        }
-        return true;
-    }
-
-    bool read_ip_item(uint64_t off, IPItem &out)
-    {
-        if (!f_)
-            return false;
-        if (std::fseek(f_, (long)off, SEEK_SET) != 0)
-        {
-            std::perror("fseek");
-            return false;
-        }
-        size_t r = std::fread(&out, 1, sizeof(IPItem), f_);
-        if (r != sizeof(IPItem))
-        {
-            std::perror("fread");
-            return false;
-        }
-        return true;
-    }
-
-private:
-    std::FILE *f_;
+    inline void push(const IPItem &) {}
+    inline void flush() {}
 };
 
-// merge_em_ip_inplace_generic with external memory for IP storage
+// merge_em_ip_inplace_generic with external memory for IP storage.
+// IP pairs go straight into the writer's staging buffers; full buffers are
+// written by the writer thread while the merge continues. Any sink with
+// push/flush (e.g. IPDiscardSink) can stand in for the writer.
 template <typename SrcItem, typename DstItem, typename IPItem,
           DstItem (*merge_func)(const SrcItem &, const SrcItem &),
           void (*sort_func)(LayerVec<SrcItem> &), bool discard_zero,
           typename KeyType, KeyType (*key_func)(const SrcItem &),
           bool (*is_zero_func)(const DstItem &) = nullptr,
           IPItem (*make_ip_func)(const SrcItem &, const SrcItem &) = nullptr,
-          const size_t IP_BATCH_SIZE = 65536, const size_t DELTA_SIZE = 128,
-          bool is_last = false>
+          bool is_last = false, typename IPSink = IPDiskWriter<IPItem>>
 inline void merge_em_ip_inplace_generic(LayerVec<SrcItem> &src_arr,
                                         LayerVec<DstItem> &dst_arr,
-                                        IPDiskWriter<IPItem> &ip_writer)
+                                        IPSink &ip_writer)
 {
     static_assert(key_func != nullptr, "Key extractor must be provided");
     static_assert(!discard_zero || is_zero_func != nullptr,
@@ -594,22 +592,13 @@ inline void merge_em_ip_inplace_generic(LayerVec<SrcItem> &src_arr,
 
     // Use deque as a FIFO queue for destination items
     std::vector<DstItem> tmp_items;
-    std::vector<IPItem> tmp_ips;
     std::vector<uint8_t> skip_buf;
     tmp_items.reserve(MAX_TMP_SIZE);
-    tmp_ips.reserve(IP_BATCH_SIZE + DELTA_SIZE);
     skip_buf.reserve(GROUP_BOUND);
 
     size_t free_bytes = 0;
     size_t avail_dst = dst_arr.capacity() - dst_arr.size();
 
-    // Helper lambda to flush IP batch to disk
-    auto flush_ips = [&]()
-    {
-        ip_writer.append_layer(tmp_ips.data(), tmp_ips.size());
-        tmp_ips.resize(0); // resie or clear
-    };
-
     size_t i = 0;
     while (i < N)
     {
@@ -639,7 +628,7 @@ inline void merge_em_ip_inplace_generic(LayerVec<SrcItem> &src_arr,
                         continue;
                     }
                     tmp_items.emplace_back(out);
-                    tmp_ips.emplace_back(make_ip_func(src_arr[j1], src_arr[j2]));
+                    ip_writer.push(make_ip_func(src_arr[j1], src_arr[j2]));
                 }
             }
         }
@@ -653,19 +642,15 @@ inline void merge_em_ip_inplace_generic(LayerVec<SrcItem> &src_arr,
                 for (size_t j2 = j1 + 1; j2 < group_end; ++j2)
                 {
                     tmp_items.emplace_back(merge_func(src_arr[j1], src_arr[j2]));
-                    tmp_ips.emplace_back(make_ip_func(src_arr[j1], src_arr[j2]));
+                    ip_writer.push(make_ip_func(src_arr[j1], src_arr[j2]));
                 }
         }
 
         const size_t tmp_size = tmp_items.size();
-        if (tmp_size >= avail_dst) // already full, we will throw away remaining tmp_items/tmp_ips
+        if (tmp_size >= avail_dst) // already full, trailing IPs beyond dst_arr.size() are never referenced
         {
             break;
         }
-        if (tmp_ips.size() >= IP_BATCH_SIZE)
-        {
-            flush_ips();
-        }
         free_bytes += group_size * sz_src;
         const size_t can_dst = free_bytes / sz_dst;
         const size_t to_move = std::min<size_t>({tmp_size, can_dst, avail_dst});
@@ -685,5 +670,99 @@ inline void merge_em_ip_inplace_generic(LayerVec<SrcItem> &src_arr,
         const size_t to_move = std::min(tmp_items.size(), avail_dst);
         drain_vectors(tmp_items, dst_arr, to_move);
     }
-    flush_ips();
+    ip_writer.flush();
+}
+
+// ------------------ Two-list merge (in-place) ------------------
+// Strict (k-list) merge: only pairs with one item from each list collide.
+// `left` and `right` are adjacent (right starts where left ends) and
+// `dst_arr` is an empty layer starting at left's first item. Outputs fill
+// the bytes both lists have consumed so far -- the front of `left`, then
+// the front of `right` -- and wait in a temporary buffer when neither has
+// room; the right zone is moved down behind the left one at the end. At
+// most `max_out` items are kept.
+template <typename SrcItem, typename DstItem,
+          DstItem (*merge_func)(const SrcItem &, const SrcItem &),
+          void (*sort_func)(LayerVec<SrcItem> &),
+          typename KeyType, KeyType (*key_func)(const SrcItem &)>
+inline void merge_two_lists_inplace_generic(LayerVec<SrcItem> &left,
+                                            LayerVec<SrcItem> &right,
+                                            LayerVec<DstItem> &dst_arr,
+                                            size_t max_out)
+{
+    static_assert(key_func != nullptr, "Key extractor must be provided");
+    sort_func(left);
+    sort_func(right);
+    const size_t n1 = left.size(), n2 = right.size();
+    const size_t sz_src = sizeof(SrcItem), sz_dst = sizeof(DstItem);
+    uint8_t *const zone_a = reinterpret_cast<uint8_t *>(dst_arr.data());
+    uint8_t *const zone_b = zone_a + n1 * sz_src;
+    const size_t region = dst_arr.capacity() * sz_dst;
+    const size_t limit = std::min(max_out, dst_arr.capacity());
+
+    std::vector<DstItem> tmp_items;
+    tmp_items.reserve(MAX_TMP_SIZE);
+    size_t na = 0, nb = 0;         // items placed in zone A / zone B
+    size_t room_a = 0, room_b = 0; // items the consumed bytes can hold
+    size_t emitted = 0;
+    auto place = [&](const DstItem &out)
+    {
+        if (na < room_a)
+            std::memcpy(zone_a + sz_dst * na++, &out, sz_dst);
+        else if (nb < room_b)
+            std::memcpy(zone_b + sz_dst * nb++, &out, sz_dst);
+        else
+            return false;
+        return true;
+    };
+    auto drain = [&]()
+    {
+        while (!tmp_items.empty() && place(tmp_items.back()))
+            tmp_items.pop_back();
+    };
+
+    size_t i = 0, j = 0;
+    while (i < n1 && j < n2 && emitted < limit)
+    {
+        const KeyType k1 = key_func(left[i]), k2 = key_func(right[j]);
+        if (k1 < k2)
+        {
+            ++i;
+        }
+        else if (k2 < k1)
+        {
+            ++j;
+        }
+        else
+        {
+            size_t e1 = i + 1, e2 = j + 1;
+            while (e1 < n1 && key_func(left[e1]) == k1)
+                ++e1;
+            while (e2 < n2 && key_func(right[e2]) == k2)
+                ++e2;
+            // The group itself is not consumed yet, so place() only
+            // overwrites items of earlier groups.
+            for (size_t a = i; a < e1 && emitted < limit; ++a)
+                for (size_t b = j; b < e2 && emitted < limit; ++b, ++emitted)
+                {
+                    DstItem out = merge_func(left[a], right[b]);
+                    if (!place(out))
+                        tmp_items.emplace_back(out);
+                }
+            i = e1;
+            j = e2;
+        }
+        room_a = i * sz_src / sz_dst;
+        room_b = j * sz_src / sz_dst;
+        if (!tmp_items.empty())
+            drain();
+    }
+
+    // Both lists are consumed: zone B runs to the end of dst_arr's region.
+    room_a = n1 * sz_src / sz_dst;
+    room_b = region > n1 * sz_src ? (region - n1 * sz_src) / sz_dst : 0;
+    drain();
+    if (nb)
+        std::memmove(zone_a + na * sz_dst, zone_b, nb * sz_dst);
+    dst_arr.resize(na + nb);
 }
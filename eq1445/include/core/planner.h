@@ -0,0 +1,160 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ------------------ Memory-budget planner ------------------
+// Picks the solver configuration for a byte budget. Candidates carry the
+// arena they need (the *_peak_memory of their mode); a calibration profile
+// holds the measured seconds per solve of each candidate on this machine.
+// The planner takes the fastest measured candidate that fits, and without
+// measurements the one with the largest arena, i.e. the least recomputation.
+
+#ifndef PLAN_HEADROOM_MB
+#define PLAN_HEADROOM_MB 64 // process memory outside the arena (binary, heap, solutions)
+#endif
+
+struct PlanCandidate
+{
+    std::string mode; // --mode value
+    int h = 0;        // switching height (cip-apr), h1 (hybrid), q (lsr)
+    uint64_t peak_bytes = 0;
+    int h2 = 0;             // second switching height (hybrid only)
+    uint64_t ooc_bytes = 0; // --ooc-mem the arena was sized with (cip-ooc only)
+    bool fallback = false;  // misses solutions by design: only when nothing else fits
+
+    std::string label() const
+    {
+        if (mode == "cip-apr" || mode == "lsr")
+            return mode + ":" + std::to_string(h);
+        if (mode == "hybrid")
+            return mode + ":" + std::to_string(h) + "-" + std::to_string(h2);
+        return mode;
+    }
+};
+
+// ---- Budget ----
+// cgroup v2 memory.max, else the v1 limit; 0 when unlimited or unreadable.
+inline uint64_t cgroup_memory_limit()
+{
+    std::ifstream v2("/sys/fs/cgroup/memory.max");
+    std::string s;
+    if (v2 >> s)
+    {
+        if (s == "max")
+            return 0;
+        char *end = nullptr;
+        errno = 0;
+        const unsigned long long v = std::strtoull(s.c_str(), &end, 10);
+        // strtoull takes a sign or leading blanks; memory.max is digits only
+        const bool digits = s[0] >= '0' && s[0] <= '9';
+        return (digits && errno == 0 && *end == '\0') ? static_cast<uint64_t>(v) : 0;
+    }
+    std::ifstream v1("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+    uint64_t limit = 0;
+    if (v1 >> limit && limit < (uint64_t(1) << 60)) // v1 reports "unlimited" as ~2^63
+        return limit;
+    return 0;
+}
+
+inline uint64_t physical_memory_bytes()
+{
+    const long pages = sysconf(_SC_PHYS_PAGES), page = sysconf(_SC_PAGESIZE);
+    return pages > 0 && page > 0 ? static_cast<uint64_t>(pages) * static_cast<uint64_t>(page) : 0;
+}
+
+// Arena budget: `cli_bytes` if given, otherwise the cgroup limit (or the
+// machine's memory) less PLAN_HEADROOM_MB. Re-read before every solve, so a
+// container resized between solves is re-planned.
+inline uint64_t plan_budget_bytes(uint64_t cli_bytes, std::string *source = nullptr)
+{
+    if (cli_bytes)
+    {
+        if (source)
+            *source = "cli";
+        return cli_bytes;
+    }
+    uint64_t limit = cgroup_memory_limit();
+    if (source)
+        *source = limit ? "cgroup" : "physical";
+    if (!limit)
+        limit = physical_memory_bytes();
+    const uint64_t headroom = static_cast<uint64_t>(PLAN_HEADROOM_MB) << 20;
+    return limit > headroom ? limit - headroom : 0;
+}
+
+// ---- Calibration profile ----
+// One "<label> <seconds>" line per measured candidate; '#' starts a comment.
+struct CalibrationProfile
+{
+    std::map<std::string, double> seconds;
+
+    bool load(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream ls(line);
+            std::string label;
+            double t;
+            if (ls >> label >> t && t > 0.0)
+                seconds[label] = t;
+        }
+        return true;
+    }
+
+    bool save(const std::string &path, const std::string &variant) const
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out)
+            return false;
+        out << "# apr calibration profile, variant=" << variant << ": <candidate> <seconds per solve>\n";
+        for (const auto &kv : seconds)
+            out << kv.first << " " << kv.second << "\n";
+        return static_cast<bool>(out);
+    }
+
+    const double *find(const PlanCandidate &c) const
+    {
+        auto it = seconds.find(c.label());
+        return it == seconds.end() ? nullptr : &it->second;
+    }
+};
+
+// Index of the candidate to run under `budget`, or -1 if none fits.
+// Fallback candidates are considered only when no other one fits.
+inline int choose_plan(const std::vector<PlanCandidate> &cands, uint64_t budget,
+                       const CalibrationProfile &profile)
+{
+    for (const bool fallback : {false, true})
+    {
+        int best_timed = -1, best_size = -1;
+        for (size_t i = 0; i < cands.size(); ++i)
+        {
+            if (cands[i].peak_bytes > budget || cands[i].fallback != fallback)
+                continue;
+            const double *t = profile.find(cands[i]);
+            if (t && (best_timed < 0 || *t < *profile.find(cands[best_timed])))
+                best_timed = static_cast<int>(i);
+            if (best_size < 0 || cands[i].peak_bytes > cands[best_size].peak_bytes)
+                best_size = static_cast<int>(i);
+        }
+        if (best_size >= 0)
+            return best_timed >= 0 ? best_timed : best_size;
+    }
+    return -1;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// ------------------ Post-retrieval checkpoints ------------------
+// recover_IP(h) replays the forward pass up to layer h-1. Recovering IP{K-1}
+// down to IP1 from layer 0 every time makes post-retrieval quadratic in K, so
+// recovery copies intermediate non-indexed layers into free arena space and
+// later recoveries restart from the highest one below them. The stack lives
+// in [front_end, hi) of whatever arena the caller has free.
+//
+// Checkpoints form a stack growing down from `hi`, lowest layer at the
+// bottom. Recoveries are issued for decreasing h, so a checkpoint at layer
+// >= h is dead for good and popped; new ones are only pushed above the one
+// a recovery started from, which keeps the stack ordered.
+//
+// A checkpoint of layer j is only placed above `front_end`, the end of the
+// region any recovery through layer j can touch, so restarting from it (or
+// from one below it) never overwrites it.
+
+struct PRCheckpoint
+{
+    int layer;
+    const uint8_t *data;
+    size_t count;
+};
+
+class PRCheckpointStack
+{
+public:
+    PRCheckpointStack() = default;
+    explicit PRCheckpointStack(uint8_t *hi) : top_(hi) {}
+
+    // Highest checkpoint that can seed a recovery of IP{h}, or nullptr.
+    const PRCheckpoint *nearest(int h)
+    {
+        while (!entries_.empty() && entries_.back().layer >= h)
+        {
+            top_ += entries_.back().count * item_bytes_.back();
+            entries_.pop_back();
+            item_bytes_.pop_back();
+        }
+        return entries_.empty() ? nullptr : &entries_.back();
+    }
+
+    // Save `count` items of `layer` if they fit above `front_end`.
+    bool push(int layer, const void *items, size_t count, size_t item_bytes, const uint8_t *front_end)
+    {
+        const size_t bytes = count * item_bytes;
+        if (count == 0 || top_ < front_end || static_cast<size_t>(top_ - front_end) < bytes ||
+            (!entries_.empty() && entries_.back().layer >= layer))
+            return false;
+        top_ -= bytes;
+        std::memcpy(top_, items, bytes);
+        entries_.push_back(PRCheckpoint{layer, top_, count});
+        item_bytes_.push_back(item_bytes);
+        return true;
+    }
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    uint8_t *top_ = nullptr;
+    std::vector<PRCheckpoint> entries_;
+    std::vector<size_t> item_bytes_;
+};
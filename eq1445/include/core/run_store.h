@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "core/equihash_base.h"
+#include "core/em_store.h"
+
+// Out-of-core (OOC) tuning knobs
+#ifndef OOC_RUN_CHUNK_BYTES
+#define OOC_RUN_CHUNK_BYTES (64 << 10) // per-partition output buffer; written to disk as one chunk
+#endif
+
+#ifndef OOC_PART_SLACK
+#define OOC_PART_SLACK 8 // partition work area = expected size * (1 + 1/OOC_PART_SLACK) + 4096 items
+#endif
+
+// ------------------ Partitioned on-disk item layer ------------------
+// An item layer that does not fit in RAM is kept on disk as `parts` runs,
+// one per key-prefix partition. Items are `append`ed to a small per-partition
+// buffer (caller-provided memory) and every full buffer becomes one chunk at
+// the end of a single file; a partition is read back by gathering its chunks.
+// All items sharing a collision key land in the same partition, so the merge
+// can process one partition at a time.
+template <typename Item>
+class PartitionedRun
+{
+public:
+    PartitionedRun() = default;
+    ~PartitionedRun() { remove(); }
+    PartitionedRun(const PartitionedRun &) = delete;
+    PartitionedRun &operator=(const PartitionedRun &) = delete;
+
+    // Bytes of buffer memory `create` needs for `parts` partitions (the same
+    // for every item type, so consecutive layers can share one region).
+    static constexpr size_t buffer_bytes(size_t parts)
+    {
+        return parts * std::max<size_t>(OOC_RUN_CHUNK_BYTES, sizeof(Item));
+    }
+
+    bool create(const std::string &path, size_t parts, uint8_t *buf, size_t buf_bytes)
+    {
+        remove();
+        if (buf_bytes < buffer_bytes(parts))
+            return false;
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0)
+        {
+            std::perror(path.c_str());
+            return false;
+        }
+        path_ = path;
+        file_pos_ = 0;
+        failed_ = false;
+        chunks_.assign(parts, {});
+        sizes_.assign(parts, 0);
+        fill_.assign(parts, 0);
+        bufs_.resize(parts);
+        for (size_t p = 0; p < parts; ++p)
+            bufs_[p] = reinterpret_cast<Item *>(buf) + p * chunk_items();
+        return true;
+    }
+
+    inline void append(size_t part, const Item &item)
+    {
+        bufs_[part][fill_[part]++] = item;
+        if (fill_[part] == chunk_items())
+            spill(part);
+    }
+
+    // Write the partially filled buffers; the run is read-only afterwards.
+    bool finish()
+    {
+        for (size_t p = 0; p < fill_.size(); ++p)
+            spill(p);
+        return !failed_;
+    }
+
+    size_t parts() const { return sizes_.size(); }
+    uint64_t part_size(size_t p) const { return sizes_[p]; }
+    uint64_t size() const
+    {
+        uint64_t n = 0;
+        for (uint64_t s : sizes_)
+            n += s;
+        return n;
+    }
+    uint64_t max_part_size() const
+    {
+        return sizes_.empty() ? 0 : *std::max_element(sizes_.begin(), sizes_.end());
+    }
+
+    // Read the first min(part_size(p), max_items) items of partition `p`.
+    bool read_part(size_t p, Item *out, size_t max_items) const
+    {
+        size_t done = 0;
+        for (const Chunk &c : chunks_[p])
+        {
+            if (done == max_items)
+                break;
+            const size_t n = std::min<size_t>(c.count, max_items - done);
+            const size_t bytes = n * sizeof(Item);
+            if (em_detail::pread_all(fd_, out + done, bytes, c.offset) != bytes)
+            {
+                std::perror("pread(run)");
+                return false;
+            }
+            done += n;
+        }
+        return true;
+    }
+
+    // Close and delete the backing file.
+    void remove()
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+            ::unlink(path_.c_str());
+            fd_ = -1;
+        }
+        chunks_.clear();
+        sizes_.clear();
+        fill_.clear();
+        bufs_.clear();
+    }
+
+private:
+    struct Chunk
+    {
+        uint64_t offset;
+        uint32_t count;
+    };
+
+    static constexpr size_t chunk_items()
+    {
+        return OOC_RUN_CHUNK_BYTES / sizeof(Item) > 0 ? OOC_RUN_CHUNK_BYTES / sizeof(Item) : 1;
+    }
+
+    int fd_ = -1;
+    std::string path_;
+    uint64_t file_pos_ = 0;
+    bool failed_ = false;
+    std::vector<std::vector<Chunk>> chunks_;
+    std::vector<uint64_t> sizes_;
+    std::vector<uint32_t> fill_;
+    std::vector<Item *> bufs_;
+
+    void spill(size_t p)
+    {
+        const size_t n = fill_[p];
+        if (n == 0)
+            return;
+        const size_t bytes = n * sizeof(Item);
+        if (em_detail::pwrite_all(fd_, bufs_[p], bytes, file_pos_) != bytes)
+        {
+            std::perror("pwrite(run)");
+            failed_ = true;
+        }
+        chunks_[p].push_back(Chunk{file_pos_, static_cast<uint32_t>(n)});
+        sizes_[p] += n;
+        file_pos_ += bytes;
+        fill_[p] = 0;
+    }
+};
+
+// Out-of-core layout for a RAM budget: `parts` key-prefix partitions (a power
+// of two, at most 2^max_bits) and the bytes of the work area one partition is
+// merged in.
+struct OOCPlan
+{
+    unsigned part_bits = 0;
+    size_t parts = 1;
+    size_t part_items = 0; // capacity of the work area in largest items
+    size_t work_bytes = 0;
+};
+
+// Smallest partitioning whose work area plus `fixed_bytes` and the run
+// buffers (`run_bytes_per_part` each) fit in `budget`, or the one needing the
+// least memory when none does; budget 0 picks 2^default_bits partitions.
+inline OOCPlan ooc_plan(size_t list_items, size_t item_bytes, size_t budget, size_t fixed_bytes,
+                        size_t run_bytes_per_part, unsigned max_bits, unsigned default_bits)
+{
+    OOCPlan best;
+    size_t best_total = SIZE_MAX;
+    for (unsigned bits = 0; bits <= max_bits; ++bits)
+    {
+        OOCPlan plan;
+        plan.part_bits = bits;
+        plan.parts = size_t(1) << bits;
+        const size_t expect = (list_items + plan.parts - 1) / plan.parts;
+        plan.part_items = expect + expect / OOC_PART_SLACK + 4096;
+        plan.work_bytes = plan.part_items * item_bytes;
+        const size_t total = plan.work_bytes + fixed_bytes + plan.parts * run_bytes_per_part;
+        if (budget == 0 ? bits == std::min(default_bits, max_bits) : total <= budget)
+            return plan;
+        if (total < best_total)
+        {
+            best = plan;
+            best_total = total;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "core/solution_set.h"
+#include "core/util.h"
+#include "core/verify.h"
+
+// ------------------ Streaming expansion ------------------
+// Requires Item_IP and Layer_IP from the including translation unit
+// (include the variant's util header first).
+//
+// expand_solutions() takes every IP{K} pair through all layers at once, so
+// the first solution exists only when the last one does. With every IP
+// layer in RAM the pairs can instead be expanded one at a time: each is
+// taken down to its 2^K leaves, verified and handed to the callback, which
+// returns false once it has what it needs and cancels the pairs left.
+
+// Called with the 2^K leaf indices of each valid solution; return false to
+// stop the expansion.
+using SolutionCallback = std::function<bool(const uint32_t *indices, size_t width)>;
+
+// Expand the pairs of ips[0] = IP{K} through ips[1..layers-1] = IP{K-1}..IP1
+// one by one and stream the valid solutions of `seed` to `cb`. Returns the
+// number of solutions streamed.
+inline size_t stream_solutions(int seed, const Layer_IP *const *ips, size_t layers,
+                               const SolutionCallback &cb)
+{
+    const Layer_IP &top = *ips[0];
+    BatchVerifier verifier(static_cast<uint32_t>(seed));
+    SolutionSet one;
+    size_t streamed = 0;
+    for (size_t p = 0; p < top.size(); ++p)
+    {
+        one.init(1, [&](size_t, uint32_t &left, uint32_t &right)
+                 {
+                     left = static_cast<uint32_t>(get_index_from_bytes(top[p].index_pointer_left));
+                     right = static_cast<uint32_t>(get_index_from_bytes(top[p].index_pointer_right));
+                 });
+        for (size_t j = 1; j < layers && !one.empty(); ++j)
+            expand_solutions(one, *ips[j]); // drops the pair once it turns trivial
+        if (one.empty())
+            continue;
+        const VerifyReport rep = verifier.verify(one);
+        if (rep.valid == 0)
+            continue;
+        ++streamed;
+        if (!cb(one[0], one.width()))
+            break;
+    }
+    return streamed;
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A trivial solution is one where every index appears an even number of
+// times. Even counts cancel under XOR, so a nonzero XOR of the indices
+// rejects almost every real solution in one pass; otherwise a sorted copy
+// in `scratch` (reused across calls) must pair up.
+inline bool solution_is_trivial(const uint32_t *indices, size_t width,
+                                std::vector<uint32_t> &scratch)
+{
+    uint32_t x = 0;
+    for (size_t i = 0; i < width; ++i)
+        x ^= indices[i];
+    if (x != 0 || (width & 1) != 0)
+        return false;
+    scratch.assign(indices, indices + width);
+    std::sort(scratch.begin(), scratch.end());
+    for (size_t i = 0; i < scratch.size(); i += 2)
+        if (i + 1 >= scratch.size() || scratch[i] != scratch[i + 1])
+            return false;
+    return true;
+}
+
+// ------------------ Flat solution storage ------------------
+// All solutions of one run in a single uint32_t buffer. Solution s owns the
+// slot [s * stride, (s + 1) * stride) with stride = 2^K, so the backward
+// pass never reallocates: it starts at width 2 (the two refs of an IP{K}
+// pair) and every round doubles the width in place until the slots hold
+// the 2^K leaf indices.
+//
+// The default slot width is 2^K of the compiled-in parameter set
+// (default_stride(), defined in core/util.h); solvers whose K is only known
+// at run time pass the stride explicitly.
+class SolutionSet
+{
+public:
+    SolutionSet() = default;
+    explicit SolutionSet(size_t stride) : stride_(stride) {}
+
+    static size_t default_stride();
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    size_t width() const { return width_; }
+    size_t stride() const { return stride_; }
+
+    uint32_t *operator[](size_t s) { return idx_.data() + s * stride_; }
+    const uint32_t *operator[](size_t s) const { return idx_.data() + s * stride_; }
+
+    // Start `count` solutions of width 2; pair_of(i, left, right) fills
+    // solution i. The set counts as started (width 2) even when count is 0,
+    // so a later round cannot mistake it for a fresh one.
+    template <typename PairOf>
+    void init(size_t count, PairOf &&pair_of)
+    {
+        idx_.assign(count * stride_, 0);
+        count_ = count;
+        width_ = 2;
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t *sol = (*this)[i];
+            pair_of(i, sol[0], sol[1]);
+        }
+    }
+
+    // ---- Ref-ordered expansion ----
+    // A backward round replaces every ref r at position j of a slot by the
+    // pair stored at IP position r, written to positions 2j and 2j+1.
+    // Looking the refs up in solution order misses cache and TLB on every
+    // access into a multi-million-entry layer, so rounds are driven by a
+    // key list sorted by ref: the layer is walked in ascending address
+    // order, repeated refs are adjacent, and put() scatters each pair back.
+    //
+    //   solutions.ref_order(keys);   // drops trivial solutions first
+    //   for (uint64_t key : keys) solutions.put(key, left(ref_of(key)), ...);
+    //   solutions.widen();
+    //
+    // Every ref is captured in `keys` before the first put(), so slots can
+    // be overwritten freely.
+
+    // Key of one ref: IP position in the high half, destination in the low.
+    static uint32_t ref_of(uint64_t key) { return static_cast<uint32_t>(key >> 32); }
+
+    // Sorted keys of every ref of every solution. Solutions whose refs all
+    // occur an even number of times can only expand into even leaf counts,
+    // so they are dropped here, before they are expanded.
+    void ref_order(std::vector<uint64_t> &keys)
+    {
+        drop_trivial();
+        keys.clear();
+        keys.reserve(count_ * width_);
+        for (size_t s = 0; s < count_; ++s)
+        {
+            const uint32_t *sol = (*this)[s];
+            const uint64_t dst = s * stride_;
+            for (size_t j = 0; j < width_; ++j)
+                keys.push_back((static_cast<uint64_t>(sol[j]) << 32) | (dst + 2 * j));
+        }
+        std::sort(keys.begin(), keys.end());
+    }
+
+    void put(uint64_t key, uint32_t left, uint32_t right)
+    {
+        uint32_t *dst = idx_.data() + static_cast<uint32_t>(key);
+        dst[0] = left;
+        dst[1] = right;
+    }
+
+    // Finish a round after every put(). The round that fills the 2^K-index
+    // slots also runs the leaf-level trivial test.
+    void widen()
+    {
+        assert(2 * width_ <= stride_ && "SolutionSet expanded past 2^K indices");
+        width_ *= 2;
+        if (full())
+            drop_trivial();
+    }
+
+    bool full() const { return width_ == stride_; }
+
+    // Append one finished solution of `stride` indices, for solvers that
+    // carry whole index vectors and have no backward pass.
+    void push_full(const uint32_t *indices)
+    {
+        idx_.insert(idx_.end(), indices, indices + stride_);
+        ++count_;
+        width_ = stride_;
+    }
+
+    // Drop the solutions for which pred(indices, width) holds, keeping order.
+    template <typename Pred>
+    void remove_if(Pred &&pred)
+    {
+        size_t kept = 0;
+        for (size_t s = 0; s < count_; ++s)
+        {
+            if (pred(static_cast<const uint32_t *>((*this)[s]), width_))
+                continue;
+            if (kept != s)
+                std::copy((*this)[s], (*this)[s] + width_, (*this)[kept]);
+            ++kept;
+        }
+        count_ = kept;
+        idx_.resize(count_ * stride_);
+    }
+
+    void drop_trivial()
+    {
+        remove_if([this](const uint32_t *indices, size_t width)
+                  { return solution_is_trivial(indices, width, scratch_); });
+    }
+
+    std::vector<size_t> to_vector(size_t s) const
+    {
+        return std::vector<size_t>((*this)[s], (*this)[s] + width_);
+    }
+
+    void clear()
+    {
+        idx_.clear();
+        count_ = 0;
+        width_ = 0;
+    }
+
+private:
+    std::vector<uint32_t> idx_;
+    size_t count_ = 0;
+    size_t width_ = 0;
+    size_t stride_ = default_stride();
+    std::vector<uint32_t> scratch_;
+};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "core/pr_checkpoint.h"
+#include "core/solution_set.h"
+#include "core/util.h"
+
+// ------------------ Step-wise CIP-APR ------------------
+// Requires EquihashParams, the Layer/LayerIDX templates and the generic
+// merges from the including translation unit (include the variant's util
+// header first).
+//
+// CIP-APR as an explicit state machine: step() runs one merge of
+// the forward pass or of a recovery, or expands one RAM IP layer, and
+// returns. Everything between steps lives in the stepper and the arena, so
+// the caller may stop calling step() at any boundary, to drop stale work
+// (a new block header) or to run something else and resume later with the
+// arena untouched. A cancel takes effect within one layer's time.
+// run_advanced_cip_pr simply steps until done().
+//
+// Layout: the items and the IP layer being produced at the front,
+// IP{h+1..K-1} stacked down from the end; size the arena with
+// advanced_cip_pr_peak_memory. Recoveries start once those RAM layers are
+// expanded, so their checkpoints (core/pr_checkpoint.h) may take the whole
+// arena past the front; with h = K-1 the forward pass checkpoints too. A
+// sparse recovery keeps only the pairs the solutions reference instead of
+// building the IP layer.
+
+// Bytes at the front of the arena that a recovery passing through layer I
+// may touch: indexed layers only shrink from there on, and out_IP reuses it.
+template <size_t I>
+constexpr uint64_t pr_front_bytes()
+{
+    return std::max<uint64_t>(MAX_LIST_SIZE * sizeof(ItemIDX<I>), MAX_LIST_SIZE * sizeof(Item_IP));
+}
+
+template <typename Seq>
+struct CipStepLayers;
+
+template <size_t... Is>
+struct CipStepLayers<std::index_sequence<Is...>>
+{
+    using Plain = std::tuple<std::optional<Layer<Is>>...>;
+    using Indexed = std::tuple<std::optional<LayerIDX<Is>>...>;
+};
+
+class CipStepper
+{
+public:
+    static constexpr size_t K = EquihashParams::K;
+
+    // h is the switching height: IP{h+1..K-1} kept in RAM, IP{1..h} recomputed,
+    // with `checkpoints` and `sparse` as g_pr_checkpoints and g_pr_sparse.
+    CipStepper(int seed, int h, uint8_t *base, uint64_t arena_bytes, bool checkpoints, bool sparse)
+        : seed_(seed), h_(static_cast<size_t>(h < 0 ? 0 : (h > int(K) - 1 ? int(K) - 1 : h))), base_(base),
+          checkpoints_(checkpoints), sparse_(sparse), ckpt_(base + arena_bytes)
+    {
+        const uint64_t ip_bytes = MAX_LIST_SIZE * sizeof(Item_IP);
+        uint8_t *end = base + arena_bytes;
+        size_t stacked = 0;
+        for (size_t j = h_ + 1; j < K; ++j)
+            ram_[j].emplace(init_layer<Item_IP>(end - (++stacked) * ip_bytes, ip_bytes));
+        begin_pass(h_, K);
+    }
+
+    bool done() const { return phase_ == Phase::DONE; }
+
+    // Steps taken so far: one per layer a pass generates, loads from a
+    // checkpoint or merges, and one per RAM layer expanded.
+    size_t steps() const { return steps_; }
+
+    // Run the next merge or expansion. No-op once done().
+    void step()
+    {
+        switch (phase_)
+        {
+        case Phase::FORWARD:
+        case Phase::RECOVER:
+            if (pass_step())
+                finish_pass();
+            break;
+        case Phase::EXPAND:
+            if (ram_[layer_])
+            {
+                expand_solutions(solutions_, *ram_[layer_]);
+                next_layer();
+            }
+            else
+            {
+                phase_ = Phase::RECOVER;
+                begin_pass(layer_ - 1, layer_);
+                if (pass_step())
+                    finish_pass();
+            }
+            break;
+        case Phase::DONE:
+            return;
+        }
+        ++steps_;
+    }
+
+    // The expanded solutions once done().
+    SolutionSet &solutions() { return solutions_; }
+
+private:
+    enum class Phase
+    {
+        FORWARD, // layers 0..K, producing IP{h+1..K}
+        EXPAND,  // next: IP{layer_} from RAM, or start its recovery
+        RECOVER, // replaying layers 0..layer_-1 into IP{layer_}
+        DONE,
+    };
+
+    using Layers = CipStepLayers<std::make_index_sequence<K>>;
+
+    // A pass runs layers 0..top-1, indexed from `indexed_from` on, and
+    // merges the last one into the front IP layer (or, sparse, into the
+    // referenced pairs only).
+    void begin_pass(size_t indexed_from, size_t top)
+    {
+        indexed_from_ = indexed_from;
+        top_ = top;
+        cur_ = -1;
+        indexed_ = false;
+        ckpt_pass_ = checkpoints_ && (phase_ == Phase::RECOVER || h_ + 1 == K);
+        sparse_pass_ = sparse_ && phase_ == Phase::RECOVER;
+        if (sparse_pass_)
+            wanted_ = solution_refs(solutions_);
+        else
+            front_.emplace(init_layer<Item_IP>(base_, MAX_LIST_SIZE * sizeof(Item_IP)));
+    }
+
+    // Returns true once the front IP layer is complete.
+    bool pass_step()
+    {
+        if (cur_ < 0)
+        {
+            if (const PRCheckpoint *c = ckpt_pass_ ? ckpt_.nearest(static_cast<int>(top_)) : nullptr)
+            {
+                load_checkpoint<1>(*c);
+                cur_ = c->layer;
+                return false;
+            }
+            auto &L0 = std::get<0>(plain_);
+            L0.emplace(init_layer<Item<0>>(base_, MAX_LIST_SIZE * sizeof(Item<0>)));
+            fill_layer0(*L0, seed_);
+            cur_ = 0;
+            return false;
+        }
+        return advance<0>();
+    }
+
+    template <size_t I>
+    void load_checkpoint(const PRCheckpoint &c)
+    {
+        if (c.layer == static_cast<int>(I))
+        {
+            auto &S = std::get<I>(plain_);
+            S.emplace(init_layer<Item<I>>(base_, MAX_LIST_SIZE * sizeof(Item<I>)));
+            S->resize(c.count);
+            std::memcpy(S->data(), c.data, c.count * sizeof(Item<I>));
+            return;
+        }
+        if constexpr (I + 2 < K)
+            load_checkpoint<I + 1>(c);
+    }
+
+    template <size_t I>
+    bool advance()
+    {
+        if (static_cast<size_t>(cur_) != I)
+        {
+            if constexpr (I + 1 < K)
+                return advance<I + 1>();
+            return true;
+        }
+        if (!indexed_ && I == indexed_from_)
+        {
+            auto &S = std::get<I>(plain_);
+            std::get<I>(indexed_layers_).emplace(expand_layer_to_idx_inplace<Item<I>, ItemIDX<I>>(*S));
+            S.reset();
+            indexed_ = true;
+        }
+        if (indexed_)
+        {
+            auto &S = std::get<I>(indexed_layers_);
+            if (I + 1 == top_)
+            {
+                if (sparse_pass_)
+                    emitted_ = merge_for_ip_sparse<I>(*S, MAX_LIST_SIZE, wanted_, pairs_);
+                else
+                    merge_inplace_for_ip<I>(*S, *front_);
+                S.reset();
+                return true;
+            }
+            if constexpr (I + 1 < K)
+            {
+                auto &D = std::get<I + 1>(indexed_layers_);
+                D.emplace(init_layer<ItemIDX<I + 1>>(base_, MAX_LIST_SIZE * sizeof(ItemIDX<I + 1>)));
+                merge_ip_inplace<I>(*S, *D, *ram_[I + 1]);
+                set_index_batch(*D);
+            }
+            S.reset();
+        }
+        else if constexpr (I + 1 < K)
+        {
+            auto &S = std::get<I>(plain_);
+            if (ckpt_pass_ && I >= 1)
+                ckpt_.push(static_cast<int>(I), S->data(), S->size(), sizeof(Item<I>), base_ + pr_front_bytes<I>());
+            auto &D = std::get<I + 1>(plain_);
+            D.emplace(init_layer<Item<I + 1>>(base_, MAX_LIST_SIZE * sizeof(Item<I + 1>)));
+            merge_inplace<I>(*S, *D);
+            S.reset();
+        }
+        ++cur_;
+        return false;
+    }
+
+    // The front IP layer is IP{layer_}: IP{K} after the forward pass.
+    void finish_pass()
+    {
+        if (sparse_pass_)
+        {
+            if (g_verbose)
+                std::cout << "Layer " << layer_ << " IP pairs emitted: " << emitted_ << ", kept: " << pairs_.size() << std::endl;
+            expand_solutions_sparse(solutions_, wanted_, pairs_);
+            pairs_.clear();
+        }
+        else
+        {
+            if (g_verbose)
+                std::cout << "Layer " << layer_ << " IP size: " << front_->size() << std::endl;
+            expand_solutions(solutions_, *front_);
+            front_.reset();
+        }
+        next_layer();
+    }
+
+    void next_layer()
+    {
+        --layer_;
+        phase_ = (layer_ >= 1 && !solutions_.empty()) ? Phase::EXPAND : Phase::DONE;
+    }
+
+    int seed_;
+    size_t h_;
+    uint8_t *base_;
+    bool checkpoints_;
+    bool sparse_;
+    PRCheckpointStack ckpt_;
+    Phase phase_ = Phase::FORWARD;
+    size_t layer_ = K; // IP layer expanded next
+    size_t steps_ = 0;
+
+    size_t indexed_from_ = 0;
+    size_t top_ = K;
+    int cur_ = -1; // layer holding the items of the pass, -1 before layer 0
+    bool indexed_ = false;
+    bool ckpt_pass_ = false;   // checkpoint the non-indexed layers of this pass
+    bool sparse_pass_ = false; // keep only the pairs in wanted_
+    std::vector<size_t> wanted_;
+    std::vector<Item_IP> pairs_;
+    size_t emitted_ = 0;
+    Layers::Plain plain_;
+    Layers::Indexed indexed_layers_;
+    std::optional<Layer_IP> front_;
+    std::array<std::optional<Layer_IP>, K> ram_;
+    SolutionSet solutions_;
+};
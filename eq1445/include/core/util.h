@@ -9,12 +9,19 @@
 #include <algorithm>
 #include <vector>
 #include <random>
-#include <unordered_map>
 #include <iostream>
 #include "core/merge.h"
+#include "core/mem_stats.h"
+#include "core/leaf_gen.h"
 #include "core/zcash_blake.h"
+#include "core/solution_set.h"
+#include "core/verify.h"
+
+inline size_t SolutionSet::default_stride()
+{
+    return size_t(1) << EquihashParams::K;
+}
 
-typedef std::vector<size_t> Solution;
 
 template <typename ItemT>
 inline void print_item_hash(const char *label, const ItemT &item,
@@ -70,112 +77,95 @@ inline void print_solution_indices(const char *label,
 }
 
 // ---------- L0 filling ----------
-#ifdef __cplusplus
-extern "C" {
-#endif
-#include "blake2bip.h"  // For 4-way Blake2b
-#ifdef __cplusplus
-}
-#endif
-
-template <typename Layer_Type>
-inline void fill_layer0(Layer_Type &L0, int seed)
+// Hashes every index of the seed's instance under `Gen` (core/leaf_gen.h)
+// and hands the raw output to `sink(hash_index, out)`. One output holds
+// kLeavesPerHash leaves of kLayer0XorBytes each: leaf hash_index *
+// kLeavesPerHash + j is out[j * XOR..(j + 1) * XOR). Bits above N in each
+// leaf's top byte are already cleared (kLeafTopMask).
+template <typename Gen = LeafGenerator, typename Sink>
+inline void for_each_leaf_hash(int seed, Sink &&sink)
 {
-    // Match Tromp's implementation exactly:
-    // headernonce is 140 bytes with nonce at position 108 (word 27)
-    uint8_t headernonce[140];
-    std::memset(headernonce, 0, sizeof(headernonce));
-
-    // Put nonce at position 108 (as u32 word 27) in little-endian format
-    // This matches: ((u32 *)headernonce)[27] = htole32(nonce);
-    uint32_t *nonce_ptr = (uint32_t *)(headernonce + 108);
-    *nonce_ptr = seed; // Already little-endian on x86
-
-    // allocate L0
-    using ValueType = typename Layer_Type::value_type;
-    static constexpr uint32_t HALF = EquihashParams::kLeafCountHalf;
-    static constexpr uint32_t FULL = EquihashParams::kLeafCountFull;
-    static constexpr size_t XOR_SLICE = ItemXorSize<ValueType>;
-    L0.resize(FULL);
+    static constexpr uint32_t HASHES = EquihashParams::kHashCount;
+    static constexpr size_t LPH = EquihashParams::kLeavesPerHash;
+    static constexpr size_t LEAF_BYTES = EquihashParams::kLayer0XorBytes;
+    static constexpr uint8_t TOP_MASK = EquihashParams::kLeafTopMask;
 
-    // Build midstate with headernonce (no separate nonce array)
-    // We need to match Tromp's setheader which only takes the 140-byte
-    // headernonce
-    uint8_t dummy_nonce[32];
-    std::memset(dummy_nonce, 0, sizeof(dummy_nonce));
+    Gen G;
+    G.init_seed(static_cast<uint32_t>(seed));
 
-    ZcashEquihashHasher H;
-    H.init_midstate(headernonce, sizeof(headernonce), dummy_nonce,
-                    EquihashParams::N,
-                    EquihashParams::K);
-
-    // Process indices in blocks of 4 (NBLAKES=4)
-    uint8_t out[4][ZcashEquihashHasher::OUT_LEN];
-    uint32_t i = 0;
-    for (; i + 3 < HALF; i += 4)
+    auto emit = [&](uint32_t i, uint8_t *out)
     {
-#ifdef NBLAKES
-        // 4-way Blake2b: output 4 x 64 bytes, take first 50 bytes from each
-        uint8_t hashes[4 * 64];
-        blake2bx4_final(&H.mid_, hashes, i / 4);  // i/4 is block index
-        for (int lane = 0; lane < 4; ++lane)
+        if constexpr (TOP_MASK != 0xFF)
         {
-            const uint8_t *ph = hashes + lane * 64;
-            std::memcpy(out[lane], ph, ZcashEquihashHasher::OUT_LEN);  // Copy first 50 bytes
+            for (size_t j = 0; j < LPH; ++j)
+                out[j * LEAF_BYTES + LEAF_BYTES - 1] &= TOP_MASK;
         }
-#else
-        H.hash_index(i + 0, out[0]);
-        H.hash_index(i + 1, out[1]);
-        H.hash_index(i + 2, out[2]);
-        H.hash_index(i + 3, out[3]);
-#endif
+        sink(i, static_cast<const uint8_t *>(out));
+    };
 
-        // Store 8 leaves (2 per index)
-        for (int lane = 0; lane < 4; ++lane)
-        {
-            const int base = (2 * (i + lane));
-            std::memcpy(L0[base + 0].XOR, out[lane] + 0, XOR_SLICE);
-            std::memcpy(L0[base + 1].XOR, out[lane] + XOR_SLICE, XOR_SLICE);
-        }
+    // Whole batches, then the tail one index at a time
+    alignas(64) uint8_t out[Gen::BATCH * Gen::STRIDE];
+    uint32_t i = 0;
+    for (; i + Gen::BATCH <= HASHES; i += Gen::BATCH)
+    {
+        G.hash_batch(i, out);
+        for (size_t lane = 0; lane < Gen::BATCH; ++lane)
+            emit(i + static_cast<uint32_t>(lane), out + lane * Gen::STRIDE);
     }
-    // tail
-    for (; i < HALF; ++i)
+    for (; i < HASHES; ++i)
     {
-        H.hash_index(i, out[0]);
-        std::memcpy(L0[2 * i + 0].XOR, out[0] + 0, XOR_SLICE);
-        std::memcpy(L0[2 * i + 1].XOR, out[0] + XOR_SLICE, XOR_SLICE);
+        G.hash_index(i, out);
+        emit(i, out);
     }
 }
 
-inline Item0 compute_ith_item(int seed, size_t leaf_index)
+// Leaf-level view of for_each_leaf_hash: `sink(leaf_index, xor_bytes)` for
+// every leaf in [0, kLeafCountFull). The last hash may carry leaves past the
+// end of the leaf space (96_5 packs five per output); those are skipped.
+template <typename Gen = LeafGenerator, typename Sink>
+inline void for_each_leaf(int seed, Sink &&sink)
 {
-    // compute the same leaf value that fill_layer0 writes at L0[leaf_index]
-    // leaf_index is in [0 .. FULL-1]; each pair of leaves corresponds to a
-    // single hash output: L0[2*i+0] = out[0..24], L0[2*i+1] = out[25..49]
-    uint8_t headernonce[140];
-    std::memset(headernonce, 0, sizeof(headernonce));
-
-    uint32_t *nonce_ptr = (uint32_t *)(headernonce + 108);
-    *nonce_ptr = seed; // Already little-endian on x86
+    static constexpr uint32_t FULL = EquihashParams::kLeafCountFull;
+    static constexpr size_t LPH = EquihashParams::kLeavesPerHash;
+    static constexpr size_t LEAF_BYTES = EquihashParams::kLayer0XorBytes;
+
+    for_each_leaf_hash<Gen>(seed, [&](uint32_t i, const uint8_t *out)
+                       {
+                           const size_t first = size_t(i) * LPH;
+                           for (size_t j = 0; j < LPH && first + j < FULL; ++j)
+                               sink(first + j, out + j * LEAF_BYTES); });
+}
 
-    uint8_t dummy_nonce[32];
-    std::memset(dummy_nonce, 0, sizeof(dummy_nonce));
+template <typename Gen = LeafGenerator, typename Layer_Type>
+inline void fill_layer0(Layer_Type &L0, int seed)
+{
+    using ValueType = typename Layer_Type::value_type;
+    static constexpr uint32_t FULL = EquihashParams::kLeafCountFull;
+    static constexpr size_t XOR_SLICE = ItemXorSize<ValueType>;
+    L0.resize(FULL);
 
-    ZcashEquihashHasher H;
-    H.init_midstate(headernonce, sizeof(headernonce), dummy_nonce,
-                    EquihashParams::N,
-                    EquihashParams::K);
+    for_each_leaf<Gen>(seed, [&](size_t leaf, const uint8_t *x)
+                       { std::memcpy(L0[leaf].XOR, x, XOR_SLICE); });
+}
 
-    const uint32_t pair_idx = static_cast<uint32_t>(leaf_index / 2);
-    const bool second = (leaf_index & 1) != 0;
+template <typename Gen = LeafGenerator>
+inline Item0 compute_ith_item(int seed, size_t leaf_index)
+{
+    // compute the same leaf value that fill_layer0 writes at L0[leaf_index]:
+    // leaf_index is in [0 .. FULL-1] and lives in hash leaf_index / LPH at
+    // slot leaf_index % LPH
+    // (check_zero_xor uses BatchVerifier, which builds the midstate once)
+    static constexpr size_t LPH = EquihashParams::kLeavesPerHash;
+    Gen G;
+    G.init_seed(static_cast<uint32_t>(seed));
 
-    uint8_t out[ZcashEquihashHasher::OUT_LEN];
-    H.hash_index(pair_idx, out);
+    uint8_t out[Gen::OUT_LEN];
+    G.hash_index(static_cast<uint32_t>(leaf_index / LPH), out);
 
     Item0 item;
     constexpr size_t XOR_SLICE = ItemXorSize<Item0>;
-    const size_t offset = second ? XOR_SLICE : 0;
-    std::memcpy(item.XOR, out + offset, XOR_SLICE);
+    std::memcpy(item.XOR, out + (leaf_index % LPH) * XOR_SLICE, XOR_SLICE);
+    item.XOR[XOR_SLICE - 1] &= EquihashParams::kLeafTopMask;
     return item;
 }
 
@@ -212,263 +202,216 @@ inline void fill_layer_from_mt(Layer_Type &L0, int seed)
     }
 }
 
-inline void expand_solution(Solution &solution, const Layer_IP &IP)
+/**
+ * @brief Expand all solutions through one on-disk IP layer with a single
+ *        ordered pass over the file.
+ *
+ * Every reference of every solution is collected, sorted by file position and
+ * deduplicated. Neighbouring references are coalesced into extents of at most
+ * EM_GATHER_EXTENT_BYTES per stripe (holes below EM_GATHER_GAP_BYTES are read through),
+ * the next extent is announced to the kernel for readahead, and the fetched
+ * pairs are scattered back to their solution slots.
+ */
+inline void expand_solutions_from_file(SolutionSet &solutions,
+                                       IPDiskReader<Item_IP> &reader,
+                                       const IPDiskMeta &meta)
 {
-    if (IP.empty())
-    {
-        solution.clear();
+    if (meta.count == 0 || solutions.empty())
         return;
-    }
-    Solution out;
-    out.reserve(solution.size() * 2);
-    for (size_t idx_ref : solution)
+
+    // Every ref of every solution in file order (see SolutionSet::ref_order)
+    std::vector<uint64_t> refs;
+    solutions.ref_order(refs);
+    if (!refs.empty() && SolutionSet::ref_of(refs.back()) >= meta.count)
     {
-        if (idx_ref >= IP.size()){
-            assert(false && "Index out of bounds in expand_solution");
-        }
-        const Item_IP &ip = IP[idx_ref];
-        out.push_back(get_index_from_bytes(ip.index_pointer_left));
-        out.push_back(get_index_from_bytes(ip.index_pointer_right));
+        std::cout << "Error: idx_ref " << SolutionSet::ref_of(refs.back()) << " >= meta.count " << meta.count
+                  << std::endl;
+        assert(false && "Index out of bounds in expand_solutions_from_file");
     }
-    solution.swap(out);
-}
+    auto ref_at = [&](size_t r) -> size_t
+    { return SolutionSet::ref_of(refs[r]); };
+
+    constexpr size_t stride = sizeof(Item_IP);
+    const uint64_t first_item = meta.offset / stride;
+    constexpr size_t gap_items = EM_GATHER_GAP_BYTES / stride;
+    // A striped store serves one extent from all devices at once.
+    const size_t extent_items = (EM_GATHER_EXTENT_BYTES / stride > 0 ? EM_GATHER_EXTENT_BYTES / stride : 1) *
+                                reader.stripe_count();
+
+    // Returns one past the last ref that belongs to the extent starting at `b`.
+    auto extent_end = [&](size_t b)
+    {
+        size_t e = b + 1;
+        while (e < refs.size() && ref_at(e) - ref_at(e - 1) <= gap_items + 1 &&
+               ref_at(e) - ref_at(b) < extent_items)
+            ++e;
+        return e;
+    };
 
-inline void expand_solution_from_file(Solution &solution,
-                                      IPDiskReader<Item_IP> &reader,
-                                      const IPDiskMeta &meta)
-{
-    Solution out;
-    out.reserve(solution.size() * 2);
-    for (size_t idx_ref : solution)
+    std::vector<Item_IP> extent;
+    size_t b = 0;
+    size_t e = extent_end(b);
+    while (b < refs.size())
     {
-        if (idx_ref >= meta.count)
+        const size_t lo = ref_at(b);
+        const size_t hi = ref_at(e - 1) + 1;
+        const size_t next_b = e;
+        const size_t next_e = next_b < refs.size() ? extent_end(next_b) : next_b;
+        if (next_b < refs.size())
+        {
+            reader.advise_items(first_item + ref_at(next_b),
+                                ref_at(next_e - 1) + 1 - ref_at(next_b));
+        }
+
+        extent.resize(hi - lo);
+        if (!reader.read_items(first_item + lo, extent.size(), extent.data()))
         {
-            std::cout << "Error: idx_ref " << idx_ref << " >= meta.count " << meta.count << std::endl;
-            assert(false && "Index out of bounds in expand_solution_from_file");
+            std::cerr << "Error reading IP extent [" << lo << ", " << hi << ") from file" << std::endl;
+            assert(false && "Failed to read IP extent from file");
         }
-        Item_IP ip{};
-        bool succ  = reader.read_ip_item(meta.offset + idx_ref * sizeof(Item_IP), ip);
-        if (!succ)
+        for (size_t r = b; r < e; ++r)
         {
-            std::cerr << "Error reading IP item from file at index " << idx_ref << std::endl;
-            assert(false && "Failed to read IP item from file");
+            const Item_IP &ip = extent[ref_at(r) - lo];
+            solutions.put(refs[r], static_cast<uint32_t>(get_index_from_bytes(ip.index_pointer_left)),
+                          static_cast<uint32_t>(get_index_from_bytes(ip.index_pointer_right)));
         }
-        out.push_back(get_index_from_bytes(ip.index_pointer_left));
-        out.push_back(get_index_from_bytes(ip.index_pointer_right));
+        b = next_b;
+        e = next_e;
     }
-    solution.swap(out);
+    solutions.widen();
 }
 
-inline void expand_solutions_from_file(std::vector<Solution> &solutions,
-                                       IPDiskReader<Item_IP> &reader,
-                                       const IPDiskMeta &meta)
-{
-    if (meta.count == 0 || solutions.empty())
-        return;
-    
-    for (auto &sol : solutions)
-    {
-        expand_solution_from_file(sol, reader, meta);
-    }
-}
+#ifndef EXPAND_PREFETCH_DISTANCE
+#define EXPAND_PREFETCH_DISTANCE 16 // refs ahead to prefetch during in-RAM expansion
+#endif
 
-inline void expand_solutions(std::vector<Solution> &solutions, const Layer_IP &IP)
+// The first layer expanded (IP{K}) seeds one solution per pair; later
+// layers are gathered in ascending IP order (SolutionSet::ref_order) with
+// software prefetching and scattered back into the slots.
+inline void expand_solutions(SolutionSet &solutions, const Layer_IP &IP)
 {
-    if (IP.empty())
-        return;
-    if (solutions.empty())
+    auto pair_of = [&](size_t ref, uint32_t &left, uint32_t &right)
     {
-        solutions.resize(IP.size());
-        for (size_t i = 0; i < IP.size(); ++i)
-        {
-            solutions[i].reserve(2);
-            solutions[i].push_back(get_index_from_bytes(IP[i].index_pointer_left));
-            solutions[i].push_back(get_index_from_bytes(IP[i].index_pointer_right));
-        }
+        assert(ref < IP.size() && "Index out of bounds in expand_solutions");
+        left = static_cast<uint32_t>(get_index_from_bytes(IP[ref].index_pointer_left));
+        right = static_cast<uint32_t>(get_index_from_bytes(IP[ref].index_pointer_right));
+    };
+    // A fresh set starts from the IP{K} pairs; one that was started and has
+    // since lost every solution to the trivial filter stays empty.
+    if (solutions.width() == 0)
+    {
+        solutions.init(IP.size(), pair_of);
         return;
     }
-    else
+    if (solutions.empty())
+        return;
+
+    std::vector<uint64_t> keys;
+    solutions.ref_order(keys);
+    const Item_IP *ip = IP.data();
+    const size_t n = keys.size();
+    for (size_t k = 0; k < n; ++k)
     {
-        for (auto &sol : solutions)
-        {
-            expand_solution(sol, IP);
-        }
+        if (k + EXPAND_PREFETCH_DISTANCE < n)
+            __builtin_prefetch(ip + SolutionSet::ref_of(keys[k + EXPAND_PREFETCH_DISTANCE]));
+        uint32_t left, right;
+        pair_of(SolutionSet::ref_of(keys[k]), left, right);
+        solutions.put(keys[k], left, right);
     }
+    solutions.widen();
 }
 
-static inline bool is_trivial_solution(const Solution &solution)
-{
-    std::unordered_map<size_t, size_t> cnt;
-    cnt.reserve(solution.size() * 2);
-    for (size_t x : solution)
-        cnt[x]++;
-    for (auto &kv : cnt)
-        if ((kv.second & 1) != 0)
-            return false;
-    return true;
-}
-
-/**
- * @brief Remove trivial solutions from expanded in-place.
- *
- * A trivial solution is one where every index appears an even number of times.
- * After calling this, `expanded` will only contain non-trivial chains.
- */
-inline void filter_trivial_solutions(std::vector<Solution> &solutions)
+// Sorted, unique IP positions referenced by `solutions`.
+inline std::vector<size_t> solution_refs(const SolutionSet &solutions)
 {
-    auto it = std::remove_if(solutions.begin(), solutions.end(),
-                             [](const Solution &solution)
-                             {
-                                 return is_trivial_solution(solution);
-                             });
-    solutions.erase(it, solutions.end());
+    std::vector<size_t> refs;
+    refs.reserve(solutions.size() * solutions.width());
+    for (size_t s = 0; s < solutions.size(); ++s)
+        refs.insert(refs.end(), solutions[s], solutions[s] + solutions.width());
+    std::sort(refs.begin(), refs.end());
+    refs.erase(std::unique(refs.begin(), refs.end()), refs.end());
+    return refs;
 }
 
-static inline size_t check_zero_xor(
-    const int &seed, const std::vector<Solution> &solutions)
+// Expand through a sparse IP layer: `pairs[k]` is the pair at position
+// `positions[k]` (see merge_for_ip_sparse_generic). Both sides are sorted,
+// so the refs are matched with one forward walk.
+inline void expand_solutions_sparse(SolutionSet &solutions,
+                                    const std::vector<size_t> &positions,
+                                    const std::vector<Item_IP> &pairs)
 {
-    constexpr size_t xor_len = ItemXorSize<Item0>;
-    auto is_zero = [](const std::array<uint8_t, xor_len> &acc)
-    {
-        for (uint8_t b : acc)
-        {
-            if (b)
-                return false;
-        }
-        return true;
-    };
-
-    const size_t total = solutions.size();
-    size_t trivial = 0, valid = 0;
-
-    for (size_t ci = 0; ci < total; ++ci)
+    std::vector<uint64_t> keys;
+    solutions.ref_order(keys);
+    size_t k = 0;
+    for (uint64_t key : keys)
     {
-        const auto &chain = solutions[ci];
-        if (is_trivial_solution(chain))
+        const size_t ref = SolutionSet::ref_of(key);
+        while (k < pairs.size() && positions[k] < ref)
+            ++k;
+        if (k >= pairs.size() || positions[k] != ref)
         {
-            /* Lines 349-350 omitted */
+            assert(false && "Index out of bounds in expand_solutions_sparse");
+            solutions.put(key, 0, 0);
             continue;
         }
+        solutions.put(key, static_cast<uint32_t>(get_index_from_bytes(pairs[k].index_pointer_left)),
+                      static_cast<uint32_t>(get_index_from_bytes(pairs[k].index_pointer_right)));
+    }
+    solutions.widen();
+}
 
-        std::array<uint8_t, xor_len> acc{};
-        acc.fill(0);
-        for (size_t idx : chain)
-        {
-            Item0 item = compute_ith_item(seed, idx);
-            for (size_t j = 0; j < xor_len; ++j)
-                acc[j] ^= item.XOR[j];
-        }
+extern unsigned g_verify_threads;
 
-        bool is_zero_chain = is_zero(acc);
-        if (is_zero_chain)
-            ++valid;
+// Verify a seed's expanded solutions with one BatchVerifier (midstate built
+// once, each leaf pair hashed once) and return the number of valid ones.
+static inline size_t check_zero_xor(
+    const int &seed, const SolutionSet &solutions)
+{
+    BatchVerifier verifier(static_cast<uint32_t>(seed));
+    const VerifyReport rep = verifier.verify(solutions, g_verify_threads);
 
-        if (g_verbose)
+    if (g_verbose)
+    {
+        for (size_t ci = 0; ci < rep.total; ++ci)
         {
-            ::printf("Chain %zu (size=%zu): XOR result = ", ci, chain.size());
-            for (size_t j = 0; j < xor_len; ++j)
-                ::printf("%02x", acc[j]);
-            if (is_zero_chain)
+            const uint32_t *chain = solutions[ci];
+            const size_t width = solutions.width();
+            const VerifyStatus st = rep.status[ci];
+            if (st == VerifyStatus::TRIVIAL)
+                continue;
+            const bool ok = st == VerifyStatus::OK || st == VerifyStatus::OUT_OF_ORDER;
+            ::printf("Chain %zu (size=%zu): XOR result = ", ci, width);
+            for (uint8_t b : rep.root[ci])
+                ::printf("%02x", b);
+            if (ok)
             {
-                ::printf(" ✓ VALID zero-XOR solution\n");
+                ::printf(" ✓ VALID zero-XOR solution%s\n",
+                         st == VerifyStatus::OUT_OF_ORDER ? " (not Wagner-ordered)" : "");
                 ::printf("    Indices: ");
-                size_t show_n = std::min<size_t>(16, chain.size());
+                size_t show_n = std::min<size_t>(16, width);
                 for (size_t i = 0; i < show_n; ++i)
-                    ::printf("%zx ", chain[i]);
-                if (chain.size() > show_n)
-                    ::printf("... (total %zu)", chain.size());
+                    ::printf("%x ", chain[i]);
+                if (width > show_n)
+                    ::printf("... (total %zu)", width);
                 ::printf("\n");
             }
+            else
+            {
+                ::printf(" INVALID (%s)\n",
+                         st == VerifyStatus::BAD_LENGTH ? "bad length or index" : "collision check failed");
+            }
         }
-    }
 
-    if (g_verbose)
-    {
         std::cout << "---------------------------------------------------------"
                      "----------------------\n";
         std::cout << "Solution Statistics:\n";
-        std::cout << "  Total chains: " << total << "\n";
-        std::cout << "  Trivial chains: " << trivial << "\n";
-        std::cout << "  Valid solutions: " << valid << "\n";
+        std::cout << "  Total chains: " << rep.total << "\n";
+        std::cout << "  Trivial chains: " << rep.trivial << "\n";
+        std::cout << "  Valid solutions: " << rep.valid << "\n";
+        std::cout << "  Not Wagner-ordered: " << rep.unordered << "\n";
+        std::cout << "  Leaf hashes computed: " << verifier.hashed_pairs() << "\n";
         std::cout << "========================================================="
                      "======================\n";
     }
-    return valid;
-}
-
-
-// Measure peak RSS (kB)
-static long peak_rss_kb()
-{
-    // Use Linux /proc/self/status
-    FILE *f = fopen("/proc/self/status", "r");
-    if (!f)
-        return -1;
-    char line[512];
-    long kb = -1;
-    while (fgets(line, sizeof(line), f))
-    {
-        if (std::strncmp(line, "VmHWM:", 6) == 0)
-        {
-            char *p = std::strrchr(line, '\t');
-            if (!p)
-                p = line;
-            long v = 0;
-            if (sscanf(line + 6, "%ld", &v) == 1)
-            {
-                kb = v;
-                break;
-            }
-        }
-    }
-    fclose(f);
-    return kb;
+    return rep.valid;
 }
-
-// Measure current USS (Unique Set Size) in kilobytes.
-// This reads /proc/self/smaps_rollup and sums Private_Dirty and Private_Clean
-// which approximates the process' private RSS (USS). If smaps_rollup is not
-// available, fall back to VmRSS from /proc/self/status (less precise).
-static inline long current_uss_kb()
-{
-    // Prefer smaps_rollup when available (aggregated per-process values).
-    FILE *f = fopen("/proc/self/smaps_rollup", "r");
-    if (f)
-    {
-        char line[256];
-        long private_dirty = 0;
-        long private_clean = 0;
-        while (fgets(line, sizeof(line), f))
-        {
-            if (std::strncmp(line, "Private_Dirty:", 14) == 0)
-            {
-                long v = 0;
-                if (sscanf(line + 14, "%ld", &v) == 1)
-                    private_dirty += v;
-            }
-            else if (std::strncmp(line, "Private_Clean:", 14) == 0)
-            {
-                long v = 0;
-                if (sscanf(line + 14, "%ld", &v) == 1)
-                    private_clean += v;
-            }
-        }
-        fclose(f);
-        return private_dirty + private_clean;
-    }
-    // cannot read, error
-    std::cerr << "Warning: cannot open /proc/self/smaps_rollup for USS measurement, falling back to VmRSS\n";
-    return -1;
-}
-
-static inline void debug_print_uss(const char *tag)
-{
-    long kb = current_uss_kb();
-    std::cout << "[USS] " << tag << " USS=" << kb << " kB\n";
-}
-
-static inline void debug_print_rss(const char *tag)
-{
-    size_t kb = peak_rss_kb();
-    std::cout << "[RSS] " << tag << " VmRSS=" << kb << " kB\n";
-}
\ No newline at end of file
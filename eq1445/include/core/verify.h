@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "core/solution_set.h"
+#include "core/leaf_gen.h"
+
+// ------------------ Batch solution verifier ------------------
+// Checks an expanded SolutionSet (2^K leaf indices in tree order) against one
+// seeded LeafGenerator. All leaf indices of the batch are deduplicated by
+// hash index (leaf / kLeavesPerHash) and every hash is computed once; hashes
+// sharing a generator batch go through one hash_batch call.
+//
+// Each solution is then folded bottom-up like verifyrec in Tromp's equi.h:
+// at level r the XOR of every 2^r-leaf subtree must have its low r*ell bits
+// zero (the bits the solver collided on) and the root must be all zero.
+// Wagner ordering (first index of the left subtree below that of the right)
+// is recorded separately because the solver does not canonicalize trees;
+// pass require_order to reject unordered solutions as a pool would.
+
+enum class VerifyStatus : uint8_t
+{
+    OK,
+    TRIVIAL,      // every index occurs an even number of times
+    BAD_LENGTH,   // not 2^K indices, or an index outside the leaf space
+    BAD_XOR,      // a subtree fails its collision or the root is nonzero
+    OUT_OF_ORDER  // XOR is fine but some subtree pair is not ordered
+};
+
+struct VerifyReport
+{
+    static constexpr size_t LEAF_BYTES = EquihashParams::kLayer0XorBytes;
+
+    size_t total = 0;
+    size_t trivial = 0;
+    size_t valid = 0;
+    size_t unordered = 0;
+    std::vector<VerifyStatus> status;
+    std::vector<std::array<uint8_t, LEAF_BYTES>> root; // XOR of all leaves
+};
+
+// Run fn(begin, end) over [0, n) on up to `threads` threads (0 = one per
+// core), giving each at least `min_per_thread` elements.
+template <typename Fn>
+inline void verify_parallel_for(size_t n, size_t min_per_thread, unsigned threads, Fn &&fn)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t workers = std::min<size_t>(threads, std::max<size_t>(1, n / std::max<size_t>(1, min_per_thread)));
+    if (workers <= 1)
+    {
+        fn(size_t(0), n);
+        return;
+    }
+    const size_t chunk = (n + workers - 1) / workers;
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t w = 1; w < workers; ++w)
+    {
+        const size_t b = std::min(n, w * chunk), e = std::min(n, b + chunk);
+        pool.emplace_back([&fn, b, e]
+                          { fn(b, e); });
+    }
+    fn(size_t(0), std::min(n, chunk));
+    for (auto &t : pool)
+        t.join();
+}
+
+class BatchVerifier
+{
+public:
+    static constexpr size_t K = EquihashParams::K;
+    static constexpr size_t ELL = EquihashParams::kCollisionBitLength;
+    static constexpr size_t SOL_LEN = size_t(1) << K;
+    static constexpr size_t LEAF_BYTES = VerifyReport::LEAF_BYTES;
+    static constexpr size_t LEAF_COUNT = EquihashParams::kLeafCountFull;
+    static constexpr size_t LPH = EquihashParams::kLeavesPerHash;
+    using Leaf = std::array<uint8_t, LEAF_BYTES>;
+
+    static constexpr size_t kMinPairsPerThread = 256;
+    static constexpr size_t kMinSolutionsPerThread = 8;
+
+    explicit BatchVerifier(uint32_t seed) { G_.init_seed(seed); }
+    explicit BatchVerifier(const LeafGenerator &G) : G_(G) {}
+
+    VerifyReport verify(const SolutionSet &solutions,
+                        unsigned threads = 1, bool require_order = false)
+    {
+        VerifyReport rep;
+        rep.total = solutions.size();
+        rep.status.assign(rep.total, VerifyStatus::OK);
+        rep.root.assign(rep.total, Leaf{});
+
+        const size_t width = solutions.width();
+        pairs_.clear();
+        pairs_.reserve(rep.total * width);
+        for (size_t s = 0; s < rep.total; ++s)
+            for (size_t j = 0; j < width; ++j)
+                if (solutions[s][j] < LEAF_COUNT)
+                    pairs_.push_back(static_cast<uint32_t>(solutions[s][j] / LPH));
+        std::sort(pairs_.begin(), pairs_.end());
+        pairs_.erase(std::unique(pairs_.begin(), pairs_.end()), pairs_.end());
+        leaves_.resize(LPH * pairs_.size());
+
+        verify_parallel_for(pairs_.size(), kMinPairsPerThread, threads,
+                            [&](size_t b, size_t e)
+                            { hash_pairs(b, e); });
+
+        verify_parallel_for(rep.total, kMinSolutionsPerThread, threads,
+                            [&](size_t b, size_t e)
+                            {
+                                std::vector<Leaf> work(SOL_LEN / 2);
+                                std::vector<uint32_t> scratch;
+                                for (size_t i = b; i < e; ++i)
+                                    rep.status[i] = check(solutions[i], width, work, scratch, rep.root[i]);
+                            });
+
+        for (VerifyStatus s : rep.status)
+        {
+            if (s == VerifyStatus::TRIVIAL)
+                ++rep.trivial;
+            else if (s == VerifyStatus::OK)
+                ++rep.valid;
+            else if (s == VerifyStatus::OUT_OF_ORDER)
+            {
+                ++rep.unordered;
+                if (!require_order)
+                    ++rep.valid;
+            }
+        }
+        return rep;
+    }
+
+    // Hash indices computed by the last verify() call.
+    size_t hashed_pairs() const { return pairs_.size(); }
+
+private:
+    void hash_pairs(size_t b, size_t e)
+    {
+        constexpr size_t BATCH = LeafGenerator::BATCH, STRIDE = LeafGenerator::STRIDE;
+        alignas(64) uint8_t hashes[BATCH * STRIDE];
+        uint32_t block = UINT32_MAX;
+        for (size_t k = b; k < e; ++k)
+        {
+            const uint32_t p = pairs_[k];
+            const uint8_t *out = hashes;
+            if (p / BATCH < EquihashParams::kHashCount / BATCH)
+            {
+                if (p / BATCH != block)
+                {
+                    block = static_cast<uint32_t>(p / BATCH);
+                    G_.hash_batch(block * static_cast<uint32_t>(BATCH), hashes);
+                }
+                out = hashes + (p % BATCH) * STRIDE;
+            }
+            else
+            {
+                block = UINT32_MAX;
+                G_.hash_index(p, hashes);
+            }
+            for (size_t j = 0; j < LPH; ++j)
+            {
+                Leaf &l = leaves_[LPH * k + j];
+                std::memcpy(l.data(), out + j * LEAF_BYTES, LEAF_BYTES);
+                l[LEAF_BYTES - 1] &= EquihashParams::kLeafTopMask;
+            }
+        }
+    }
+
+    const Leaf &leaf(size_t idx) const
+    {
+        const size_t k = std::lower_bound(pairs_.begin(), pairs_.end(),
+                                          static_cast<uint32_t>(idx / LPH)) -
+                         pairs_.begin();
+        return leaves_[LPH * k + idx % LPH];
+    }
+
+    static void xor_into(Leaf &dst, const Leaf &a, const Leaf &b)
+    {
+        for (size_t j = 0; j < LEAF_BYTES; ++j)
+            dst[j] = a[j] ^ b[j];
+    }
+
+    static bool low_bits_zero(const Leaf &x, size_t bits)
+    {
+        const size_t by = std::min(bits / 8, LEAF_BYTES);
+        for (size_t j = 0; j < by; ++j)
+            if (x[j])
+                return false;
+        if (by < LEAF_BYTES && (bits % 8) != 0)
+            return (x[by] & ((1u << (bits % 8)) - 1)) == 0;
+        return true;
+    }
+
+    VerifyStatus check(const uint32_t *sol, size_t width, std::vector<Leaf> &work,
+                       std::vector<uint32_t> &scratch, Leaf &root) const
+    {
+        if (solution_is_trivial(sol, width, scratch))
+            return VerifyStatus::TRIVIAL;
+        if (width != SOL_LEN)
+            return VerifyStatus::BAD_LENGTH;
+        for (size_t j = 0; j < width; ++j)
+            if (sol[j] >= LEAF_COUNT)
+                return VerifyStatus::BAD_LENGTH;
+
+        bool xor_ok = true, ordered = true;
+        for (size_t r = 1; r <= K; ++r)
+        {
+            const size_t nodes = SOL_LEN >> r, half = size_t(1) << (r - 1);
+            for (size_t i = 0; i < nodes; ++i)
+            {
+                if (r == 1)
+                    xor_into(work[i], leaf(sol[2 * i]), leaf(sol[2 * i + 1]));
+                else
+                    xor_into(work[i], work[2 * i], work[2 * i + 1]);
+                xor_ok = xor_ok && low_bits_zero(work[i], r < K ? r * ELL : LEAF_BYTES * 8);
+                ordered = ordered && sol[2 * i * half] < sol[(2 * i + 1) * half];
+            }
+        }
+        root = work[0];
+        if (!xor_ok)
+            return VerifyStatus::BAD_XOR;
+        return ordered ? VerifyStatus::OK : VerifyStatus::OUT_OF_ORDER;
+    }
+
+    LeafGenerator G_;
+    std::vector<uint32_t> pairs_;
+    std::vector<Leaf> leaves_;
+};
@@ -6,6 +6,23 @@ extern "C" {
 #include "blake2.h"
 }
 
+// First 8 bytes of the BLAKE2b personalization; LE32(n) || LE32(k) follow.
+// Forks of the Zcash construction differ only here; pick one with
+// -DEQ_PERSONAL=<tag>.
+struct ZcashPersonal {
+    static constexpr char kTag[9] = "ZcashPoW";
+};
+struct BgoldPersonal {
+    static constexpr char kTag[9] = "BgoldPoW";
+};
+struct ZelPersonal {
+    static constexpr char kTag[9] = "ZelProof";
+};
+
+#ifndef EQ_PERSONAL
+#define EQ_PERSONAL ZcashPersonal
+#endif
+
 // Generic Equihash BLAKE2b midstate helper. Requires the including
 // translation unit to have already selected an Equihash parameter header
 // (e.g. `eq200_9/equihash_200_9.h` or `eq144_5/equihash_144_5.h`) so that
@@ -15,14 +32,13 @@ struct ZcashEquihashHasher {
     static constexpr uint32_t N_BITS = EquihashParams::N;
     static constexpr uint32_t K_ROUNDS = EquihashParams::K;
     static constexpr size_t OUT_LEN =
-        50;  // Zcash Equihash outputs 50 bytes per index
+        EquihashParams::kHashOutputBytes;  // 50 bytes for 200_9 and 144_5
 
     blake2b_state mid_;  // midstate after absorbing header||nonce
 
     static inline void make_personal(uint8_t pers[16], uint32_t n = N_BITS,
                                      uint32_t k = K_ROUNDS) {
-        static const uint8_t ZPow[8] = {'Z', 'c', 'a', 's', 'h', 'P', 'o', 'W'};
-        std::memcpy(pers, ZPow, 8);
+        std::memcpy(pers, EQ_PERSONAL::kTag, 8);
         pers[8] = uint8_t(n & 0xFF);
         pers[9] = uint8_t((n >> 8) & 0xFF);
         pers[10] = uint8_t((n >> 16) & 0xFF);
@@ -33,12 +49,9 @@ struct ZcashEquihashHasher {
         pers[15] = uint8_t((k >> 24) & 0xFF);
     }
 
-    // Initialize midstate: digest_len=50,
-    // personal="ZcashPoW"||LE32(n)||LE32(k). Absorb header (arbitrary length)
-    // then 32-byte nonce.
-    void init_midstate(const uint8_t* header, size_t header_len,
-                       const uint8_t nonce[32], uint32_t n = N_BITS,
-                       uint32_t k = K_ROUNDS) {
+    // Fresh state with digest_len=OUT_LEN and the Equihash personalization.
+    static inline void init_personal(blake2b_state& S, uint32_t n = N_BITS,
+                                     uint32_t k = K_ROUNDS) {
         uint8_t pers[16];
         make_personal(pers, n, k);
         blake2b_param P;
@@ -47,12 +60,27 @@ struct ZcashEquihashHasher {
         P.fanout = 1;
         P.depth = 1;
         std::memcpy(P.personal, pers, 16);
-        if (blake2b_init_param(&mid_, &P) != 0)
+        if (blake2b_init_param(&S, &P) != 0)
             throw std::runtime_error("blake2b_init_param failed");
+    }
+
+    // Initialize midstate: digest_len=OUT_LEN,
+    // personal=EQ_PERSONAL||LE32(n)||LE32(k). Absorb header (arbitrary length)
+    // then 32-byte nonce.
+    void init_midstate(const uint8_t* header, size_t header_len,
+                       const uint8_t nonce[32], uint32_t n = N_BITS,
+                       uint32_t k = K_ROUNDS) {
+        init_personal(mid_, n, k);
         if (header && header_len) blake2b_update(&mid_, header, header_len);
         blake2b_update(&mid_, nonce, 32);
     }
 
+    // Midstate for a solver seed. With a block header installed (g_header)
+    // the seed is a nonce counter over it; otherwise this matches Tromp's
+    // setheader: a zeroed 140-byte headernonce with the seed as LE32 word 27
+    // (offset 108) and an all-zero 32-byte nonce.
+    inline void init_seed(uint32_t seed);
+
     // Hash a single 32-bit index with midstate reuse.
     inline void hash_index(uint32_t idx, uint8_t* out50) const {
         blake2b_state S = mid_;
@@ -62,4 +90,69 @@ struct ZcashEquihashHasher {
         blake2b_update(&S, le, 4);
         blake2b_final(&S, out50, OUT_LEN);
     }
-};
\ No newline at end of file
+};
+
+// ---- Block header input ----
+// A Zcash header is 108 bytes and the nonce 32: BLAKE2b block 0 holds the
+// header and nonce[0..20), block 1 the rest of the nonce and the 4-byte hash
+// index. ZcashHeaderPrefix compresses block 0 once per header, so a nonce
+// that differs only from byte NONCE_FIXED on costs one state copy and an
+// 11-byte absorb instead of a parameter block and a compression. The
+// solver seed s selects the nonce whose LE64 counter at COUNTER_OFFSET is
+// the given nonce's counter plus s. The multi-lane hashers (blake2bx4_final,
+// blake2bx8_final) assume this layout: exactly one block compressed before
+// the index.
+struct ZcashHeaderPrefix {
+    static constexpr size_t HEADER_LEN = 108;
+    static constexpr size_t NONCE_LEN = 32;
+    static constexpr size_t NONCE_FIXED = BLAKE2B_BLOCKBYTES - HEADER_LEN + 1;  // 21: one byte past block 0
+    static constexpr size_t COUNTER_OFFSET = 24;
+
+    blake2b_state prefix_;     // header || nonce[0..NONCE_FIXED), block 0 compressed
+    uint8_t nonce_[NONCE_LEN];
+
+    bool init(const uint8_t* header, size_t header_len, const uint8_t nonce[NONCE_LEN]) {
+        if (!header || header_len != HEADER_LEN) return false;
+        std::memcpy(nonce_, nonce, NONCE_LEN);
+        ZcashEquihashHasher::init_personal(prefix_);
+        blake2b_update(&prefix_, header, header_len);
+        blake2b_update(&prefix_, nonce, NONCE_FIXED);
+        return true;
+    }
+
+    void nonce_for(uint64_t seed, uint8_t out[NONCE_LEN]) const {
+        std::memcpy(out, nonce_, NONCE_LEN);
+        uint64_t counter = 0;
+        for (size_t i = 0; i < 8; ++i)
+            counter |= uint64_t(nonce_[COUNTER_OFFSET + i]) << (8 * i);
+        counter += seed;
+        for (size_t i = 0; i < 8; ++i)
+            out[COUNTER_OFFSET + i] = uint8_t((counter >> (8 * i)) & 0xFF);
+    }
+
+    void midstate(uint64_t seed, blake2b_state& mid) const {
+        uint8_t nonce[NONCE_LEN];
+        nonce_for(seed, nonce);
+        mid = prefix_;
+        blake2b_update(&mid, nonce + NONCE_FIXED, NONCE_LEN - NONCE_FIXED);
+    }
+};
+
+// Installed by the driver for --header; null solves the seed instances.
+extern const ZcashHeaderPrefix* g_header;
+
+inline void ZcashEquihashHasher::init_seed(uint32_t seed) {
+    if (g_header) {
+        g_header->midstate(seed, mid_);
+        return;
+    }
+    uint8_t headernonce[140];
+    std::memset(headernonce, 0, sizeof(headernonce));
+    headernonce[108] = uint8_t(seed & 0xFF);
+    headernonce[109] = uint8_t((seed >> 8) & 0xFF);
+    headernonce[110] = uint8_t((seed >> 16) & 0xFF);
+    headernonce[111] = uint8_t((seed >> 24) & 0xFF);
+    uint8_t nonce[32];
+    std::memset(nonce, 0, sizeof(nonce));
+    init_midstate(headernonce, sizeof(headernonce), nonce, N_BITS, K_ROUNDS);
+}
@@ -25,6 +25,12 @@ struct EquihashParams_144_5
     // 35000000 slightly greater than 2^25 = 33554432
     static constexpr std::size_t kMaxListSize = 34000000;
     static constexpr std::size_t kInitialListSize = kLeafCountFull;
+
+    // Two leaves from each 50-byte BLAKE2b output (leaf i from hash i / 2)
+    static constexpr std::size_t kLeavesPerHash = 2;
+    static constexpr std::size_t kHashOutputBytes = 50;
+    static constexpr std::uint32_t kHashCount = kLeafCountHalf;
+    static constexpr std::uint8_t kLeafTopMask = 0xFF; // N is a multiple of 8
 };
 } // namespace equihash
 
@@ -176,8 +176,59 @@ inline void merge4_inplace_for_ip(Layer4_IDX &s, Layer_IP &d)
                                  &make_ip_pair<Item4_IDX, Item_IP>, true>(s, d);
 }
 
+inline size_t merge0_for_ip_sparse(Layer0_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item0_IDX, Item1_IDX, Item_IP,
+                                       merge_item0_IDX, sort24<Item0_IDX>, false,
+                                       uint32_t, &getKey24<Item0_IDX>,
+                                       &is_zero_item<Item1_IDX>,
+                                       &make_ip_pair<Item0_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge1_for_ip_sparse(Layer1_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item1_IDX, Item2_IDX, Item_IP,
+                                       merge_item1_IDX, sort24<Item1_IDX>, false,
+                                       uint32_t, &getKey24<Item1_IDX>,
+                                       &is_zero_item<Item2_IDX>,
+                                       &make_ip_pair<Item1_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge2_for_ip_sparse(Layer2_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item2_IDX, Item3_IDX, Item_IP,
+                                       merge_item2_IDX, sort24<Item2_IDX>, false,
+                                       uint32_t, &getKey24<Item2_IDX>,
+                                       &is_zero_item<Item3_IDX>,
+                                       &make_ip_pair<Item2_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge3_for_ip_sparse(Layer3_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item3_IDX, Item4_IDX, Item_IP,
+                                       merge_item3_IDX, sort24<Item3_IDX>, false,
+                                       uint32_t, &getKey24<Item3_IDX>,
+                                       &is_zero_item<Item4_IDX>,
+                                       &make_ip_pair<Item3_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge4_for_ip_sparse(Layer4_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item4_IDX, Item5_IDX, Item_IP,
+                                       merge_item4_IDX, sort48<Item4_IDX>, false,
+                                       uint64_t, &getKey48<Item4_IDX>,
+                                       static_cast<bool (*)(const Item5_IDX &)>(nullptr),
+                                       &make_ip_pair<Item4_IDX, Item_IP>, true>(s, capacity, wanted, out);
+}
+
+template <typename IPSink>
 inline void merge0_em_ip_inplace(Layer0_IDX &s, Layer1_IDX &d,
-                                 EquihashIPDiskWriter &writer)
+                                 IPSink &writer)
 {
     merge_em_ip_inplace_generic<Item0_IDX, Item1_IDX, Item_IP,
                                 merge_item0_IDX, sort24<Item0_IDX>, false,
@@ -185,8 +236,9 @@ inline void merge0_em_ip_inplace(Layer0_IDX &s, Layer1_IDX &d,
                                 &is_zero_item<Item1_IDX>,
                                 &make_ip_pair<Item0_IDX, Item_IP>>(s, d, writer);
 }
+template <typename IPSink>
 inline void merge1_em_ip_inplace(Layer1_IDX &s, Layer2_IDX &d,
-                                 EquihashIPDiskWriter &writer)
+                                 IPSink &writer)
 {
     merge_em_ip_inplace_generic<Item1_IDX, Item2_IDX, Item_IP,
                                 merge_item1_IDX, sort24<Item1_IDX>, false,
@@ -194,8 +246,9 @@ inline void merge1_em_ip_inplace(Layer1_IDX &s, Layer2_IDX &d,
                                 &is_zero_item<Item2_IDX>,
                                 &make_ip_pair<Item1_IDX, Item_IP>>(s, d, writer);
 }
+template <typename IPSink>
 inline void merge2_em_ip_inplace(Layer2_IDX &s, Layer3_IDX &d,
-                                 EquihashIPDiskWriter &writer)
+                                 IPSink &writer)
 {
     merge_em_ip_inplace_generic<Item2_IDX, Item3_IDX, Item_IP,
                                 merge_item2_IDX, sort24<Item2_IDX>, false,
@@ -203,8 +256,9 @@ inline void merge2_em_ip_inplace(Layer2_IDX &s, Layer3_IDX &d,
                                 &is_zero_item<Item3_IDX>,
                                 &make_ip_pair<Item2_IDX, Item_IP>>(s, d, writer);
 }
+template <typename IPSink>
 inline void merge3_em_ip_inplace(Layer3_IDX &s, Layer4_IDX &d,
-                                 EquihashIPDiskWriter &writer)
+                                 IPSink &writer)
 {
     merge_em_ip_inplace_generic<Item3_IDX, Item4_IDX, Item_IP,
                                 merge_item3_IDX, sort24<Item3_IDX>, false,
@@ -241,10 +295,19 @@ inline void merge_inplace_for_ip(LayerIDX<I> &s, Layer_IP &d) {
     else if constexpr (I == 4) merge4_inplace_for_ip(s, d);
 }
 
-template<size_t I>
-inline void merge_em_ip_inplace(LayerIDX<I> &s, LayerIDX<I+1> &d, EquihashIPDiskWriter &writer) {
+template<size_t I, typename IPSink>
+inline void merge_em_ip_inplace(LayerIDX<I> &s, LayerIDX<I+1> &d, IPSink &writer) {
     if constexpr (I == 0) merge0_em_ip_inplace(s, d, writer);
     else if constexpr (I == 1) merge1_em_ip_inplace(s, d, writer);
     else if constexpr (I == 2) merge2_em_ip_inplace(s, d, writer);
     else if constexpr (I == 3) merge3_em_ip_inplace(s, d, writer);
 }
+
+template<size_t I>
+inline size_t merge_for_ip_sparse(LayerIDX<I> &s, size_t capacity, const std::vector<size_t> &wanted, std::vector<Item_IP> &out) {
+    if constexpr (I == 0) return merge0_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 1) return merge1_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 2) return merge2_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 3) return merge3_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 4) return merge4_for_ip_sparse(s, capacity, wanted, out);
+}
@@ -29,6 +29,12 @@ struct EquihashParams_200_9
     // 2200000 slightly greater than 2^21 = 2097152
     static constexpr std::size_t kMaxListSize = 2200000;
     static constexpr std::size_t kInitialListSize = kLeafCountFull;
+
+    // Two leaves from each 50-byte BLAKE2b output (leaf i from hash i / 2)
+    static constexpr std::size_t kLeavesPerHash = 2;
+    static constexpr std::size_t kHashOutputBytes = 50;
+    static constexpr std::uint32_t kHashCount = kLeafCountHalf;
+    static constexpr std::uint8_t kLeafTopMask = 0xFF; // N is a multiple of 8
 };
 } // namespace equihash
 
@@ -285,8 +285,99 @@ inline void merge8_inplace_for_ip(Layer8_IDX &s, Layer_IP &d)
                                  &make_ip_pair<Item8_IDX, Item_IP>, true>(s, d);
 }
 
+inline size_t merge0_for_ip_sparse(Layer0_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item0_IDX, Item1_IDX, Item_IP,
+                                       merge_item0_IDX, sort20<Item0_IDX>, true,
+                                       uint32_t, &getKey20<Item0_IDX>,
+                                       &is_zero_item<Item1_IDX>,
+                                       &make_ip_pair<Item0_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge1_for_ip_sparse(Layer1_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item1_IDX, Item2_IDX, Item_IP,
+                                       merge_item1_IDX, sort20<Item1_IDX>, true,
+                                       uint32_t, &getKey20<Item1_IDX>,
+                                       &is_zero_item<Item2_IDX>,
+                                       &make_ip_pair<Item1_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge2_for_ip_sparse(Layer2_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item2_IDX, Item3_IDX, Item_IP,
+                                       merge_item2_IDX, sort20<Item2_IDX>, true,
+                                       uint32_t, &getKey20<Item2_IDX>,
+                                       &is_zero_item<Item3_IDX>,
+                                       &make_ip_pair<Item2_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge3_for_ip_sparse(Layer3_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item3_IDX, Item4_IDX, Item_IP,
+                                       merge_item3_IDX, sort20<Item3_IDX>, true,
+                                       uint32_t, &getKey20<Item3_IDX>,
+                                       &is_zero_item<Item4_IDX>,
+                                       &make_ip_pair<Item3_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge4_for_ip_sparse(Layer4_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item4_IDX, Item5_IDX, Item_IP,
+                                       merge_item4_IDX, sort20<Item4_IDX>, true,
+                                       uint32_t, &getKey20<Item4_IDX>,
+                                       &is_zero_item<Item5_IDX>,
+                                       &make_ip_pair<Item4_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge5_for_ip_sparse(Layer5_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item5_IDX, Item6_IDX, Item_IP,
+                                       merge_item5_IDX, sort20<Item5_IDX>, true,
+                                       uint32_t, &getKey20<Item5_IDX>,
+                                       &is_zero_item<Item6_IDX>,
+                                       &make_ip_pair<Item5_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge6_for_ip_sparse(Layer6_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item6_IDX, Item7_IDX, Item_IP,
+                                       merge_item6_IDX, sort20<Item6_IDX>, true,
+                                       uint32_t, &getKey20<Item6_IDX>,
+                                       &is_zero_item<Item7_IDX>,
+                                       &make_ip_pair<Item6_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge7_for_ip_sparse(Layer7_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item7_IDX, Item8_IDX, Item_IP,
+                                       merge_item7_IDX, sort20<Item7_IDX>, true,
+                                       uint32_t, &getKey20<Item7_IDX>,
+                                       &is_zero_item<Item8_IDX>,
+                                       &make_ip_pair<Item7_IDX, Item_IP>>(s, capacity, wanted, out);
+}
+
+inline size_t merge8_for_ip_sparse(Layer8_IDX &s, size_t capacity,
+                                  const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    return merge_for_ip_sparse_generic<Item8_IDX, Item9_IDX, Item_IP,
+                                       merge_item8_IDX, sort40<Item8_IDX>, false,
+                                       uint64_t, &getKey40<Item8_IDX>,
+                                       static_cast<bool (*)(const Item9_IDX &)>(nullptr),
+                                       &make_ip_pair<Item8_IDX, Item_IP>, true>(s, capacity, wanted, out);
+}
+
+template <typename IPSink>
 inline void merge0_em_ip_inplace(Layer0_IDX &s, Layer1_IDX &d,
-                                 EquihashIPDiskWriter &w)
+                                 IPSink &w)
 {
     merge_em_ip_inplace_generic<Item0_IDX, Item1_IDX, Item_IP,
                                 merge_item0_IDX, sort20<Item0_IDX>, true,
@@ -294,8 +385,9 @@ inline void merge0_em_ip_inplace(Layer0_IDX &s, Layer1_IDX &d,
                                 &is_zero_item<Item1_IDX>,
                                 &make_ip_pair<Item0_IDX, Item_IP>>(s, d, w);
 }
+template <typename IPSink>
 inline void merge1_em_ip_inplace(Layer1_IDX &s, Layer2_IDX &d,
-                                 EquihashIPDiskWriter &w)
+                                 IPSink &w)
 {
     merge_em_ip_inplace_generic<Item1_IDX, Item2_IDX, Item_IP,
                                 merge_item1_IDX, sort20<Item1_IDX>, true,
@@ -303,8 +395,9 @@ inline void merge1_em_ip_inplace(Layer1_IDX &s, Layer2_IDX &d,
                                 &is_zero_item<Item2_IDX>,
                                 &make_ip_pair<Item1_IDX, Item_IP>>(s, d, w);
 }
+template <typename IPSink>
 inline void merge2_em_ip_inplace(Layer2_IDX &s, Layer3_IDX &d,
-                                 EquihashIPDiskWriter &w)
+                                 IPSink &w)
 {
     merge_em_ip_inplace_generic<Item2_IDX, Item3_IDX, Item_IP,
                                 merge_item2_IDX, sort20<Item2_IDX>, true,
@@ -312,8 +405,9 @@ inline void merge2_em_ip_inplace(Layer2_IDX &s, Layer3_IDX &d,
                                 &is_zero_item<Item3_IDX>,
                                 &make_ip_pair<Item2_IDX, Item_IP>>(s, d, w);
 }
+template <typename IPSink>
 inline void merge3_em_ip_inplace(Layer3_IDX &s, Layer4_IDX &d,
-                                 EquihashIPDiskWriter &w)
+                                 IPSink &w)
 {
     merge_em_ip_inplace_generic<Item3_IDX, Item4_IDX, Item_IP,
                                 merge_item3_IDX, sort20<Item3_IDX>, true,
@@ -321,8 +415,9 @@ inline void merge3_em_ip_inplace(Layer3_IDX &s, Layer4_IDX &d,
                                 &is_zero_item<Item4_IDX>,
                                 &make_ip_pair<Item3_IDX, Item_IP>>(s, d, w);
 }
+template <typename IPSink>
 inline void merge4_em_ip_inplace(Layer4_IDX &s, Layer5_IDX &d,
-                                 EquihashIPDiskWriter &w)
+                                 IPSink &w)
 {
     merge_em_ip_inplace_generic<Item4_IDX, Item5_IDX, Item_IP,
                                 merge_item4_IDX, sort20<Item4_IDX>, true,
@@ -330,8 +425,9 @@ inline void merge4_em_ip_inplace(Layer4_IDX &s, Layer5_IDX &d,
                                 &is_zero_item<Item5_IDX>,
                                 &make_ip_pair<Item4_IDX, Item_IP>>(s, d, w);
 }
+template <typename IPSink>
 inline void merge5_em_ip_inplace(Layer5_IDX &s, Layer6_IDX &d,
-                                 EquihashIPDiskWriter &w)
+                                 IPSink &w)
 {
     merge_em_ip_inplace_generic<Item5_IDX, Item6_IDX, Item_IP,
                                 merge_item5_IDX, sort20<Item5_IDX>, true,
@@ -339,8 +435,9 @@ inline void merge5_em_ip_inplace(Layer5_IDX &s, Layer6_IDX &d,
                                 &is_zero_item<Item6_IDX>,
                                 &make_ip_pair<Item5_IDX, Item_IP>>(s, d, w);
 }
+template <typename IPSink>
 inline void merge6_em_ip_inplace(Layer6_IDX &s, Layer7_IDX &d,
-                                 EquihashIPDiskWriter &w)
+                                 IPSink &w)
 {
     merge_em_ip_inplace_generic<Item6_IDX, Item7_IDX, Item_IP,
                                 merge_item6_IDX, sort20<Item6_IDX>, true,
@@ -348,8 +445,9 @@ inline void merge6_em_ip_inplace(Layer6_IDX &s, Layer7_IDX &d,
                                 &is_zero_item<Item7_IDX>,
                                 &make_ip_pair<Item6_IDX, Item_IP>>(s, d, w);
 }
+template <typename IPSink>
 inline void merge7_em_ip_inplace(Layer7_IDX &s, Layer8_IDX &d,
-                                 EquihashIPDiskWriter &w)
+                                 IPSink &w)
 {
     merge_em_ip_inplace_generic<Item7_IDX, Item8_IDX, Item_IP,
                                 merge_item7_IDX, sort20<Item7_IDX>, true,
@@ -357,12 +455,77 @@ inline void merge7_em_ip_inplace(Layer7_IDX &s, Layer8_IDX &d,
                                 &is_zero_item<Item8_IDX>,
                                 &make_ip_pair<Item7_IDX, Item_IP>>(s, d, w);
 }
+template <typename IPSink>
 inline void merge8_em_ip_inplace(Layer8_IDX &s, Layer9_IDX &d,
-                                 EquihashIPDiskWriter &w)
+                                 IPSink &w)
 {
     merge_em_ip_inplace_generic<Item8_IDX, Item9_IDX, Item_IP,
                                 merge_item8_IDX, sort40<Item8_IDX>, false,
                                 uint64_t, &getKey40<Item8_IDX>,
                                 static_cast<bool (*)(const Item9_IDX &)>(nullptr),
-                                &make_ip_pair<Item8_IDX, Item_IP>, 65536, 128, true>(s, d, w);
+                                &make_ip_pair<Item8_IDX, Item_IP>, true>(s, d, w);
+}
+
+// Template wrappers for indexed access
+template<size_t I>
+inline void merge_inplace(Layer<I> &s, Layer<I+1> &d) {
+    if constexpr (I == 0) merge0_inplace(s, d);
+    else if constexpr (I == 1) merge1_inplace(s, d);
+    else if constexpr (I == 2) merge2_inplace(s, d);
+    else if constexpr (I == 3) merge3_inplace(s, d);
+    else if constexpr (I == 4) merge4_inplace(s, d);
+    else if constexpr (I == 5) merge5_inplace(s, d);
+    else if constexpr (I == 6) merge6_inplace(s, d);
+    else if constexpr (I == 7) merge7_inplace(s, d);
+}
+
+template<size_t I>
+inline void merge_ip_inplace(LayerIDX<I> &s, LayerIDX<I+1> &d, Layer_IP &ip) {
+    if constexpr (I == 0) merge0_ip_inplace(s, d, ip);
+    else if constexpr (I == 1) merge1_ip_inplace(s, d, ip);
+    else if constexpr (I == 2) merge2_ip_inplace(s, d, ip);
+    else if constexpr (I == 3) merge3_ip_inplace(s, d, ip);
+    else if constexpr (I == 4) merge4_ip_inplace(s, d, ip);
+    else if constexpr (I == 5) merge5_ip_inplace(s, d, ip);
+    else if constexpr (I == 6) merge6_ip_inplace(s, d, ip);
+    else if constexpr (I == 7) merge7_ip_inplace(s, d, ip);
+    else if constexpr (I == 8) merge8_ip_inplace(s, d, ip);
+}
+
+template<size_t I>
+inline void merge_inplace_for_ip(LayerIDX<I> &s, Layer_IP &d) {
+    if constexpr (I == 0) merge0_inplace_for_ip(s, d);
+    else if constexpr (I == 1) merge1_inplace_for_ip(s, d);
+    else if constexpr (I == 2) merge2_inplace_for_ip(s, d);
+    else if constexpr (I == 3) merge3_inplace_for_ip(s, d);
+    else if constexpr (I == 4) merge4_inplace_for_ip(s, d);
+    else if constexpr (I == 5) merge5_inplace_for_ip(s, d);
+    else if constexpr (I == 6) merge6_inplace_for_ip(s, d);
+    else if constexpr (I == 7) merge7_inplace_for_ip(s, d);
+    else if constexpr (I == 8) merge8_inplace_for_ip(s, d);
+}
+
+template<size_t I, typename IPSink>
+inline void merge_em_ip_inplace(LayerIDX<I> &s, LayerIDX<I+1> &d, IPSink &writer) {
+    if constexpr (I == 0) merge0_em_ip_inplace(s, d, writer);
+    else if constexpr (I == 1) merge1_em_ip_inplace(s, d, writer);
+    else if constexpr (I == 2) merge2_em_ip_inplace(s, d, writer);
+    else if constexpr (I == 3) merge3_em_ip_inplace(s, d, writer);
+    else if constexpr (I == 4) merge4_em_ip_inplace(s, d, writer);
+    else if constexpr (I == 5) merge5_em_ip_inplace(s, d, writer);
+    else if constexpr (I == 6) merge6_em_ip_inplace(s, d, writer);
+    else if constexpr (I == 7) merge7_em_ip_inplace(s, d, writer);
+}
+
+template<size_t I>
+inline size_t merge_for_ip_sparse(LayerIDX<I> &s, size_t capacity, const std::vector<size_t> &wanted, std::vector<Item_IP> &out) {
+    if constexpr (I == 0) return merge0_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 1) return merge1_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 2) return merge2_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 3) return merge3_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 4) return merge4_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 5) return merge5_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 6) return merge6_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 7) return merge7_for_ip_sparse(s, capacity, wanted, out);
+    else if constexpr (I == 8) return merge8_for_ip_sparse(s, capacity, wanted, out);
 }
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "core/equihash_base.h"
+#include "core/equihash_params.h"
+
+// Equihash(N, K) selected at build time: the generic apr_<N>_<K> targets
+// compile src/eqgen with -DEQ_N=<N> -DEQ_K=<K>. Every layer type is derived
+// from EquihashParamsT, so any (N, K) whose leaf indices fit in 32 bits
+// builds from the same sources.
+#if !defined(EQ_N) || !defined(EQ_K)
+#error "eqgen needs EQ_N and EQ_K (e.g. -DEQ_N=96 -DEQ_K=5)"
+#endif
+
+#define EQ_STR_(x) #x
+#define EQ_STR(x) EQ_STR_(x)
+#define EQ_VARIANT EQ_STR(EQ_N) "_" EQ_STR(EQ_K) // e.g. "96_5"
+
+using EquihashParams = equihash::EquihashParamsT<EQ_N, EQ_K>;
+
+// Layer I carries N - I * ell bits; indexed items add kIndexBytes. Item<I>
+// exists for I < K, ItemIDX<I> up to the final layer K.
+template <size_t I> using Item = ItemVal<EquihashParams::layer_xor_bytes(I)>;
+template <size_t I> using ItemIDX = ItemValIdx<EquihashParams::layer_xor_bytes(I), EquihashParams::kIndexBytes>;
+template <size_t I> using Layer = LayerVec<Item<I>>;
+template <size_t I> using LayerIDX = LayerVec<ItemIDX<I>>;
+
+using Item0 = Item<0>;
+using Item0_IDX = ItemIDX<0>;
+using Layer0 = Layer<0>;
+using Layer0_IDX = LayerIDX<0>;
+
+using Item_IP = ItemIP<EquihashParams::kIndexBytes>;
+using Layer_IP = LayerVec<Item_IP>;
+
+using IPDiskMeta = equihash::IPDiskMetaT<Item_IP>;
+using IPDiskManifest = equihash::IPDiskManifestT<Item_IP, EquihashParams::K - 1>; // IP1..IP{K-1} on disk
+
+inline constexpr std::size_t MAX_LIST_SIZE = EquihashParams::kMaxListSize;
+inline constexpr std::size_t INITIAL_LIST_SIZE = EquihashParams::kInitialListSize;
@@ -0,0 +1,125 @@
+#pragma once
+
+// Lists of 2^25 and more items (ell >= 24) use the 144_5 batch sizes.
+#if EQ_N / (EQ_K + 1) >= 24
+#define MOVE_BOUND 65537 // minimum number of items to move in one batch during in-place merge
+#define MAX_TMP_SIZE 66561 // maximum pre-allocated temporary buffer size during in-place merge
+#define GROUP_BOUND 1024 // maximum group size during in-place merge
+#else
+#define MOVE_BOUND 2048 // minimum number of items to move in one batch during in-place merge
+#define MAX_TMP_SIZE 2500 // maximum pre-allocated temporary buffer size during in-place merge
+#define GROUP_BOUND 512 // maximum group size during in-place merge
+#endif
+
+#include "eqgen/equihash_gen.h"
+#include "core/merge.h"
+#include "eqgen/sort_gen.h"
+
+inline constexpr int ELL_BITS_GEN =
+    static_cast<int>(EquihashParams::kCollisionBitLength);
+
+// -----------------------------------------------------------------------------
+// Per-step merge parameters
+// -----------------------------------------------------------------------------
+// Step I merges layer I into layer I+1. Steps below K-1 collide on ell bits
+// and drop all-zero results; the last step collides on the remaining 2*ell
+// bits and keeps every pair (its output is IP{K}). This is what the
+// hand-written merge<I>_* wrappers of 200_9 and 144_5 spell out per layer.
+template <size_t I>
+struct MergeStep
+{
+    static constexpr bool kLast = I + 1 == EquihashParams::K;
+    static constexpr size_t kKeyBits = kLast ? EQGEN_FINAL_BITS : EQGEN_COLLISION_BITS;
+    using Key = std::conditional_t<(kKeyBits <= 32), uint32_t, uint64_t>;
+};
+
+template <size_t I, typename T>
+inline typename MergeStep<I>::Key merge_key(const T &item)
+{
+    return get_key_bits<T, MergeStep<I>::kKeyBits>(item);
+}
+
+template <size_t I, typename T>
+inline void merge_sort(LayerVec<T> &layer)
+{
+    sort_layer_by_key<T, MergeStep<I>::kKeyBits>(layer);
+}
+
+template <size_t I, typename T>
+inline constexpr bool (*merge_zero_fn)(const T &) =
+    MergeStep<I>::kLast ? static_cast<bool (*)(const T &)>(nullptr) : &is_zero_item<T>;
+
+// -----------------------------------------------------------------------------
+// Item merge helpers
+// -----------------------------------------------------------------------------
+template <size_t I>
+inline ItemIDX<I + 1> merge_item_idx(const ItemIDX<I> &a, const ItemIDX<I> &b)
+{
+    return merge_item_generic<ItemIDX<I>, ItemIDX<I + 1>>(a, b, ELL_BITS_GEN);
+}
+
+template <size_t I>
+inline Item<I + 1> merge_item(const Item<I> &a, const Item<I> &b)
+{
+    return merge_item_generic<Item<I>, Item<I + 1>>(a, b, ELL_BITS_GEN);
+}
+
+// Convenience aliases for disk helpers
+using EquihashIPDiskWriter = IPDiskWriter<Item_IP>;
+using EquihashIPDiskReader = IPDiskReader<Item_IP>;
+
+// -----------------------------------------------------------------------------
+// Template wrappers for indexed access
+// -----------------------------------------------------------------------------
+template <size_t I>
+inline void merge_inplace(Layer<I> &s, Layer<I + 1> &d)
+{
+    static_assert(!MergeStep<I>::kLast, "the last step only produces IP pairs");
+    merge_inplace_generic<Item<I>, Item<I + 1>, merge_item<I>, merge_sort<I, Item<I>>, true,
+                          typename MergeStep<I>::Key, &merge_key<I, Item<I>>,
+                          merge_zero_fn<I, Item<I + 1>>>(s, d);
+}
+
+template <size_t I>
+inline void merge_ip_inplace(LayerIDX<I> &s, LayerIDX<I + 1> &d, Layer_IP &ip)
+{
+    using Step = MergeStep<I>;
+    merge_ip_inplace_generic<ItemIDX<I>, ItemIDX<I + 1>, Item_IP,
+                             merge_item_idx<I>, merge_sort<I, ItemIDX<I>>, !Step::kLast,
+                             typename Step::Key, &merge_key<I, ItemIDX<I>>,
+                             merge_zero_fn<I, ItemIDX<I + 1>>,
+                             &make_ip_pair<ItemIDX<I>, Item_IP>, Step::kLast>(s, d, ip);
+}
+
+template <size_t I>
+inline void merge_inplace_for_ip(LayerIDX<I> &s, Layer_IP &d)
+{
+    using Step = MergeStep<I>;
+    merge_inplace_for_ip_generic<ItemIDX<I>, ItemIDX<I + 1>, Item_IP,
+                                 merge_item_idx<I>, merge_sort<I, ItemIDX<I>>, !Step::kLast,
+                                 typename Step::Key, &merge_key<I, ItemIDX<I>>,
+                                 merge_zero_fn<I, ItemIDX<I + 1>>,
+                                 &make_ip_pair<ItemIDX<I>, Item_IP>, Step::kLast>(s, d);
+}
+
+template <size_t I, typename IPSink>
+inline void merge_em_ip_inplace(LayerIDX<I> &s, LayerIDX<I + 1> &d, IPSink &writer)
+{
+    using Step = MergeStep<I>;
+    merge_em_ip_inplace_generic<ItemIDX<I>, ItemIDX<I + 1>, Item_IP,
+                                merge_item_idx<I>, merge_sort<I, ItemIDX<I>>, !Step::kLast,
+                                typename Step::Key, &merge_key<I, ItemIDX<I>>,
+                                merge_zero_fn<I, ItemIDX<I + 1>>,
+                                &make_ip_pair<ItemIDX<I>, Item_IP>, Step::kLast>(s, d, writer);
+}
+
+template <size_t I>
+inline size_t merge_for_ip_sparse(LayerIDX<I> &s, size_t capacity, const std::vector<size_t> &wanted, std::vector<Item_IP> &out)
+{
+    using Step = MergeStep<I>;
+    return merge_for_ip_sparse_generic<ItemIDX<I>, ItemIDX<I + 1>, Item_IP,
+                                       merge_item_idx<I>, merge_sort<I, ItemIDX<I>>, !Step::kLast,
+                                       typename Step::Key, &merge_key<I, ItemIDX<I>>,
+                                       merge_zero_fn<I, ItemIDX<I + 1>>,
+                                       &make_ip_pair<ItemIDX<I>, Item_IP>, Step::kLast>(s, capacity, wanted, out);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "eqgen/equihash_gen.h"
+#include "core/sort.h"
+
+inline constexpr std::size_t EQGEN_COLLISION_BITS = EquihashParams::kCollisionBitLength;
+inline constexpr std::size_t EQGEN_FINAL_BITS = EquihashParams::kCollisionBitLength * 2;
+
+// Key helpers ----------------------------------------------------------------
+
+template <typename T>
+inline auto get_collision_key(const T &item)
+{
+    return get_key_bits<T, EQGEN_COLLISION_BITS>(item);
+}
+
+template <typename T>
+inline auto get_final_key(const T &item)
+{
+    return get_key_bits<T, EQGEN_FINAL_BITS>(item);
+}
+
+// Sorting wrappers ------------------------------------------------------------
+
+template <typename T>
+inline void sort_collision(LayerVec<T> &layer)
+{
+    sort_layer_by_key<T, EQGEN_COLLISION_BITS>(layer);
+}
+
+template <typename T>
+inline void sort_final(LayerVec<T> &layer)
+{
+    sort_layer_by_key<T, EQGEN_FINAL_BITS>(layer);
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+#include "eqgen/equihash_gen.h"
+#include "core/util.h"
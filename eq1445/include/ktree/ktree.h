@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "core/equihash_base.h"
+#include "core/merge.h"
+#include "core/sort.h"
+
+extern "C" {
+#include "blake2.h"
+}
+
+// k-tree (k-list) Wagner solver for the strict generalized birthday
+// problem: find one message from each of 2^LGK distinct lists whose N-bit
+// hashes XOR to zero. The ktree_<N>_<LGK> targets compile src/ktree with
+// -DKT_N=<N> -DKT_LGK=<LGK>; item j of list i is BLAKE2b(nonce || "i-j")
+// truncated to N bits, as in python-poc/k_tree_algorithm.py.
+#if !defined(KT_N) || !defined(KT_LGK)
+#error "ktree needs KT_N and KT_LGK (e.g. -DKT_N=128 -DKT_LGK=7)"
+#endif
+
+#ifndef KT_TRIM_BYTES
+#define KT_TRIM_BYTES 1 // bytes per trimmed index in the first index-trimming run
+#endif
+
+#define KT_STR_(x) #x
+#define KT_STR(x) KT_STR_(x)
+#define KT_VARIANT KT_STR(KT_N) "_" KT_STR(KT_LGK) // e.g. "128_7"
+
+struct KTreeParams
+{
+    static constexpr size_t N = KT_N;
+    static constexpr size_t LGK = KT_LGK;
+    static constexpr size_t kLists = size_t(1) << LGK;
+    static constexpr size_t kEll = N / (LGK + 1); // collision bits per merge
+    static constexpr size_t kListSize = size_t(1) << kEll;
+    static constexpr size_t kMaxListSize = kListSize + kListSize / 20;
+    static constexpr size_t kHashBytes = N / 8;
+    static constexpr size_t kIndexBytes = (kEll + 7) / 8;
+    static constexpr size_t kTrimIndexBytes = KT_TRIM_BYTES;
+    static constexpr size_t kNonceBytes = 16;
+
+    // A depth-D item carries the N - D * ell bits not yet collided.
+    static constexpr size_t xor_bytes(size_t d) { return (N - d * kEll + 7) / 8; }
+
+    static_assert(N % 8 == 0, "N must be a multiple of 8");
+    static_assert(LGK >= 1, "at least two lists");
+    static_assert(N % (LGK + 1) == 0, "N must be divisible by LGK + 1");
+    static_assert(kEll < 32, "list indices are 32-bit");
+    static_assert(kHashBytes <= 64, "one BLAKE2b output per item");
+    static_assert(kTrimIndexBytes < kIndexBytes, "trimmed indices must be narrower than full ones");
+};
+
+// Depth-D item: XOR plus the index vector of its 2^D leaves, IB bytes per
+// index (kIndexBytes in full runs, kTrimIndexBytes in trimmed ones).
+template <size_t IB, size_t D>
+using KTreeItem = ItemValIdx<KTreeParams::xor_bytes(D), (size_t(1) << D) * IB>;
+
+template <size_t IB, size_t D>
+using KTreeLayer = LayerVec<KTreeItem<IB, D>>;
+
+// Root of the tree: the XOR is zero, only the index vector is left.
+template <size_t IB>
+struct KTreeIndexVec
+{
+    uint8_t index[KTreeParams::kLists * IB];
+};
+
+// Solutions as a flat array of kLists indices each, list order.
+struct KTreeSolutions
+{
+    std::vector<uint32_t> idx;
+
+    size_t size() const { return idx.size() / KTreeParams::kLists; }
+    const uint32_t *operator[](size_t s) const { return idx.data() + s * KTreeParams::kLists; }
+};
+
+// ------------------ Item generation ------------------
+struct KTreeHasher
+{
+    uint8_t nonce[KTreeParams::kNonceBytes] = {};
+
+    // Item j of list i. The PoC reads the digest as a big-endian integer;
+    // it is stored byte-reversed so the low bits lead, as the merge and
+    // key helpers expect.
+    void item(size_t list, size_t j, uint8_t *xor_out) const
+    {
+        char msg[KTreeParams::kNonceBytes + 48];
+        std::memcpy(msg, nonce, sizeof(nonce));
+        const int len = std::snprintf(msg + sizeof(nonce), sizeof(msg) - sizeof(nonce), "%zu-%zu", list, j);
+        uint8_t h[KTreeParams::kHashBytes];
+        blake2b(h, msg, nullptr, KTreeParams::kHashBytes, sizeof(nonce) + static_cast<size_t>(len), 0);
+        for (size_t t = 0; t < KTreeParams::kHashBytes; ++t)
+            xor_out[t] = h[KTreeParams::kHashBytes - 1 - t];
+    }
+};
+
+// ------------------ Merge helpers ------------------
+// Step D merges two depth-D lists into depth D+1; the last step (D =
+// LGK-1) collides on all 2*ell remaining bits.
+template <size_t D>
+struct KTreeStep
+{
+    static constexpr bool kLast = D + 1 == KTreeParams::LGK;
+    static constexpr size_t kKeyBits = (kLast ? 2 : 1) * KTreeParams::kEll;
+    using Key = std::conditional_t<(kKeyBits <= 32), uint32_t, uint64_t>;
+};
+
+template <size_t IB, size_t D>
+inline typename KTreeStep<D>::Key ktree_key(const KTreeItem<IB, D> &item)
+{
+    return get_key_bits<KTreeItem<IB, D>, KTreeStep<D>::kKeyBits>(item);
+}
+
+template <size_t IB, size_t D>
+inline void ktree_sort(KTreeLayer<IB, D> &layer)
+{
+    sort_layer_by_key<KTreeItem<IB, D>, KTreeStep<D>::kKeyBits>(layer);
+}
+
+template <size_t IB, size_t D>
+inline KTreeItem<IB, D + 1> ktree_merge_item(const KTreeItem<IB, D> &a, const KTreeItem<IB, D> &b)
+{
+    auto out = merge_item_generic<KTreeItem<IB, D>, KTreeItem<IB, D + 1>>(
+        a, b, static_cast<int>(KTreeParams::kEll));
+    std::memcpy(out.index, a.index, sizeof(a.index));
+    std::memcpy(out.index + sizeof(a.index), b.index, sizeof(b.index));
+    return out;
+}
+
+template <size_t IB>
+inline KTreeIndexVec<IB> ktree_root_item(const KTreeItem<IB, KTreeParams::LGK - 1> &a,
+                                         const KTreeItem<IB, KTreeParams::LGK - 1> &b)
+{
+    KTreeIndexVec<IB> out;
+    std::memcpy(out.index, a.index, sizeof(a.index));
+    std::memcpy(out.index + sizeof(a.index), b.index, sizeof(b.index));
+    return out;
+}
+
+template <size_t IB>
+inline uint32_t ktree_get_index(const uint8_t *p)
+{
+    uint32_t v = 0;
+    for (size_t i = 0; i < IB; ++i)
+        v |= static_cast<uint32_t>(p[i]) << (8 * i);
+    return v;
+}
+
+// ------------------ Memory ------------------
+// Building the tree in post-order keeps at most one list per depth on the
+// stack, plus the depth-0 list being generated; every merge writes its
+// output over its two inputs. With at most `max_list` items per list this
+// bounds the arena.
+template <size_t IB, size_t... D>
+constexpr size_t ktree_stack_item_bytes(std::index_sequence<D...>)
+{
+    return (sizeof(KTreeItem<IB, D>) + ...);
+}
+
+template <size_t IB>
+inline uint64_t ktree_arena_bytes(size_t max_list)
+{
+    constexpr size_t per_slot = ktree_stack_item_bytes<IB>(std::make_index_sequence<KTreeParams::LGK>{}) +
+                                sizeof(KTreeItem<IB, 0>);
+    return static_cast<uint64_t>(max_list) * per_slot;
+}
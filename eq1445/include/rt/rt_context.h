@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/solution_set.h"
+#include "rt/rt_params.h"
+#include "rt/rt_solver.h"
+
+// ------------------ Reusable solver context ------------------
+// Everything one run-time solve needs besides its input: the arena, kept
+// and grown across calls, the parameters of the last (n, k) and the
+// scratch of the verifier. The rt solvers touch no other mutable state, so
+// contexts on different threads run at once; one context serves one call at
+// a time.
+
+enum class RtMode
+{
+    AUTO,  // CIP if it fits the budget, otherwise CIP-PR
+    CIP,
+    CIP_PR,
+};
+
+enum class RtStatus
+{
+    OK,
+    BAD_PARAMS,
+    BAD_MODE,
+    OVER_BUDGET,
+    NO_MEMORY,
+};
+
+inline uint64_t rt_peak_memory(const RtParams &p, RtMode mode)
+{
+    return mode == RtMode::CIP_PR ? rt_cip_pr_peak_memory(p) : rt_cip_peak_memory(p);
+}
+
+class RtSolverContext
+{
+public:
+    RtSolverContext() = default;
+    RtSolverContext(const RtSolverContext &) = delete;
+    RtSolverContext &operator=(const RtSolverContext &) = delete;
+    ~RtSolverContext() { std::free(arena_); }
+
+    const std::string &error() const { return error_; }
+    void set_error(std::string error) { error_ = std::move(error); }
+    uint64_t arena_bytes() const { return arena_bytes_; }
+
+    // Log layer sizes of every solve to stdout (off by default).
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+    bool verbose() const { return verbose_; }
+
+    // Solve the instance of `header` || `nonce` for (n, k) within `budget`
+    // arena bytes (0: no limit). sink(indices, width) gets every valid
+    // solution and returns false to drop the rest; `delivered` counts the
+    // calls.
+    template <typename Sink>
+    RtStatus solve(uint32_t n, uint32_t k, const uint8_t *header, size_t header_len,
+                   const uint8_t nonce[32], RtMode mode, uint64_t budget, Sink &&sink,
+                   size_t &delivered)
+    {
+        delivered = 0;
+        if (!set_params(n, k))
+            return RtStatus::BAD_PARAMS;
+        if (mode == RtMode::AUTO)
+            mode = (budget == 0 || rt_cip_peak_memory(params_) <= budget) ? RtMode::CIP : RtMode::CIP_PR;
+        if (mode != RtMode::CIP && mode != RtMode::CIP_PR)
+        {
+            error_ = "unknown mode";
+            return RtStatus::BAD_MODE;
+        }
+        const uint64_t need = rt_peak_memory(params_, mode);
+        if (budget != 0 && need > budget)
+        {
+            error_ = "mode needs " + std::to_string(need) + " arena bytes, budget is " + std::to_string(budget);
+            return RtStatus::OVER_BUDGET;
+        }
+        uint8_t *base = reserve(need);
+        if (!base)
+            return RtStatus::NO_MEMORY;
+
+        RtHasher H;
+        H.init_header(params_, header, header_len, nonce);
+        SolutionSet solutions = mode == RtMode::CIP ? rt_cip(params_, H, base, verbose_) : rt_cip_pr(params_, H, base, verbose_);
+        const size_t width = params_.solution_width();
+        for (size_t s = 0; s < solutions.size() && solutions.width() == width; ++s)
+        {
+            if (!rt_solution_valid(params_, H, solutions[s], work_, scratch_))
+                continue;
+            ++delivered;
+            if (!sink(static_cast<const uint32_t *>(solutions[s]), width))
+                break;
+        }
+        error_.clear();
+        return RtStatus::OK;
+    }
+
+private:
+    bool set_params(uint32_t n, uint32_t k)
+    {
+        if (params_.n == n && params_.k == k)
+            return true;
+        RtParams p;
+        if (!rt_params_init(n, k, p, error_))
+            return false;
+        params_ = p;
+        return true;
+    }
+
+    // The arena only grows, so alternating modes or parameters settles on
+    // the largest.
+    uint8_t *reserve(uint64_t bytes)
+    {
+        if (bytes <= arena_bytes_)
+            return arena_;
+        std::free(arena_);
+        arena_ = static_cast<uint8_t *>(std::malloc(bytes));
+        arena_bytes_ = arena_ ? bytes : 0;
+        if (!arena_)
+            error_ = "failed to allocate " + std::to_string(bytes >> 20) + " MB";
+        return arena_;
+    }
+
+    RtParams params_;
+    uint8_t *arena_ = nullptr;
+    uint64_t arena_bytes_ = 0;
+    std::vector<uint8_t> work_;
+    std::vector<uint32_t> scratch_;
+    std::string error_;
+    bool verbose_ = false;
+};
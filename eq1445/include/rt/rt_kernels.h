@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+// ------------------ Width-dispatched record kernels ------------------
+// A run-time layer is a byte array of records [XOR | index] whose widths are
+// only known once (n, k) is. The per-record operations are picked once per
+// layer: widths up to RT_MAX_FIXED_WIDTH bytes get an instantiation with a
+// compile-time length (memcpy and the XOR loop unroll as for the fixed
+// ItemVal structs), anything wider takes the run-time-length fallback.
+
+#ifndef RT_MAX_FIXED_WIDTH
+#define RT_MAX_FIXED_WIDTH 48 // widest record / XOR with a dedicated kernel
+#endif
+
+using RtCopyFn = void (*)(uint8_t *dst, const uint8_t *src, size_t len);
+
+// dst[0, out_len) = (a ^ b) >> shift over in_len bytes, little-endian bits
+// as in xor_shift_right_u8.
+using RtMergeFn = void (*)(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                           size_t in_len, size_t out_len, unsigned shift);
+
+template <size_t W>
+inline void rt_copy_fixed(uint8_t *dst, const uint8_t *src, size_t)
+{
+    std::memcpy(dst, src, W);
+}
+
+inline void rt_copy_any(uint8_t *dst, const uint8_t *src, size_t len)
+{
+    std::memcpy(dst, src, len);
+}
+
+// Widest XOR a record can carry: rt_params_init caps n at 512 bits.
+constexpr size_t kRtMaxXorBytes = 64;
+
+// dst[i] takes its low bits from tmp[by + i] and its high bits from
+// tmp[by + i + 1], which past the last XOR byte is zero. out_len never
+// reaches past in_len - shift / 8; the loop is capped there anyway so the
+// compiler can see every read stays inside tmp[0, in_len).
+inline void rt_shift_out(uint8_t *dst, const uint8_t *tmp, size_t in_len, size_t out_len, unsigned shift)
+{
+    const size_t by = shift / 8;
+    const unsigned bt = shift % 8;
+    const uint8_t *s = tmp + by;
+    const size_t avail = in_len > by ? in_len - by : 0;
+    const size_t n = std::min(out_len, avail);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const uint8_t hi = i + 1 < avail ? s[i + 1] : uint8_t(0);
+        dst[i] = uint8_t((s[i] >> bt) | (hi << (8 - bt)));
+    }
+}
+
+template <size_t NI>
+inline void rt_merge_fixed(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                           size_t, size_t out_len, unsigned shift)
+{
+    uint8_t tmp[NI];
+    for (size_t i = 0; i < NI; ++i)
+        tmp[i] = a[i] ^ b[i];
+    rt_shift_out(dst, tmp, NI, out_len, shift);
+}
+
+inline void rt_merge_any(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                         size_t in_len, size_t out_len, unsigned shift)
+{
+    assert(in_len <= kRtMaxXorBytes && "XOR wider than n <= 512 allows");
+    if (in_len > kRtMaxXorBytes)
+        in_len = kRtMaxXorBytes;
+    uint8_t tmp[kRtMaxXorBytes];
+    for (size_t i = 0; i < in_len; ++i)
+        tmp[i] = a[i] ^ b[i];
+    rt_shift_out(dst, tmp, in_len, out_len, shift);
+}
+
+template <size_t... W>
+constexpr std::array<RtCopyFn, sizeof...(W)> rt_copy_table(std::index_sequence<W...>)
+{
+    return {{&rt_copy_fixed<W + 1>...}};
+}
+
+template <size_t... W>
+constexpr std::array<RtMergeFn, sizeof...(W)> rt_merge_table(std::index_sequence<W...>)
+{
+    return {{&rt_merge_fixed<W + 1>...}};
+}
+
+inline RtCopyFn rt_pick_copy(size_t len)
+{
+    static constexpr auto table = rt_copy_table(std::make_index_sequence<RT_MAX_FIXED_WIDTH>{});
+    return (len >= 1 && len <= RT_MAX_FIXED_WIDTH) ? table[len - 1] : &rt_copy_any;
+}
+
+inline RtMergeFn rt_pick_merge(size_t in_len)
+{
+    static constexpr auto table = rt_merge_table(std::make_index_sequence<RT_MAX_FIXED_WIDTH>{});
+    return (in_len >= 1 && in_len <= RT_MAX_FIXED_WIDTH) ? table[in_len - 1] : &rt_merge_any;
+}
+
+// Low `bits` bits (<= 64) of a record's XOR, the collision key.
+inline uint64_t rt_key(const uint8_t *rec, size_t xor_len, unsigned bits)
+{
+    uint64_t v = 0;
+    std::memcpy(&v, rec, std::min<size_t>(sizeof(v), xor_len));
+    return bits >= 64 ? v : (v & ((uint64_t(1) << bits) - 1));
+}
+
+inline void rt_set_index(uint8_t *p, size_t bytes, uint32_t v)
+{
+    for (size_t i = 0; i < bytes; ++i)
+        p[i] = static_cast<uint8_t>((v >> (8 * i)) & 0xFF);
+}
+
+inline uint32_t rt_get_index(const uint8_t *p, size_t bytes)
+{
+    uint32_t v = 0;
+    for (size_t i = 0; i < bytes; ++i)
+        v |= static_cast<uint32_t>(p[i]) << (8 * i);
+    return v;
+}
+
+// ------------------ Run-time-stride layer ------------------
+// LayerVec with the item size as a value: a window of `capacity` records of
+// `stride` bytes over arena memory.
+struct RtLayer
+{
+    uint8_t *data = nullptr;
+    size_t stride = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+
+    uint8_t *at(size_t i) const { return data + i * stride; }
+    bool full() const { return size == capacity; }
+};
+
+inline RtLayer rt_init_layer(uint8_t *base, size_t bytes, size_t stride)
+{
+    return RtLayer{base, stride, 0, bytes / stride};
+}
+
+// LSD radix sort of `layer` by its low `bits` key bits, using `spare` (at
+// least layer.size * stride bytes) as the other buffer. Returns the sorted
+// layer, which lives in either buffer.
+inline RtLayer rt_sort_by_key(RtLayer layer, uint8_t *spare, size_t xor_len, unsigned bits)
+{
+    constexpr unsigned kMaxDigit = 11;
+    const unsigned passes = std::max(1u, (bits + kMaxDigit - 1) / kMaxDigit);
+    const unsigned digit = (bits + passes - 1) / passes;
+    const RtCopyFn copy = rt_pick_copy(layer.stride);
+
+    std::array<size_t, (size_t(1) << kMaxDigit) + 1> count;
+    RtLayer src = layer, dst = layer;
+    dst.data = spare;
+    for (unsigned pass = 0; pass < passes; ++pass)
+    {
+        const unsigned lo = pass * digit;
+        const uint64_t mask = (uint64_t(1) << std::min(digit, bits - lo)) - 1;
+        count.fill(0);
+        for (size_t i = 0; i < src.size; ++i)
+            ++count[((rt_key(src.at(i), xor_len, bits) >> lo) & mask) + 1];
+        for (size_t d = 1; d < count.size(); ++d)
+            count[d] += count[d - 1];
+        for (size_t i = 0; i < src.size; ++i)
+        {
+            const uint8_t *rec = src.at(i);
+            copy(dst.at(count[(rt_key(rec, xor_len, bits) >> lo) & mask]++), rec, src.stride);
+        }
+        std::swap(src.data, dst.data);
+    }
+    return src;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "blake2.h"
+
+// ------------------ Run-time Equihash parameters ------------------
+// The same quantities EquihashParamsT<N, K> derives at compile time
+// (core/equihash_params.h), for an (n, k) read from the command line.
+
+struct RtParams
+{
+    uint32_t n = 0;
+    uint32_t k = 0;
+    size_t ell = 0;             // collision bits per round, n / (k + 1)
+    size_t index_bytes = 0;     // leaf / IP position width
+    size_t leaves_per_hash = 0; // 512 / n leaves per BLAKE2b output
+    size_t hash_bytes = 0;      // BLAKE2b digest length
+    uint32_t hash_count = 0;
+    uint32_t leaf_count = 0; // 2^(ell + 1)
+    size_t max_list = 0;
+    // Bits above n in a leaf's top byte. For n % 8 != 0 leaves are padded
+    // to ceil(n / 8) digest bytes and masked, not bit-packed as in the
+    // Equihash spec, so results differ from a standard (n, k) solver.
+    uint8_t top_mask = 0xFF;
+
+    // Layer i carries the n - i * ell bits that are not yet collided.
+    size_t xor_bytes(size_t layer) const { return (n - layer * ell + 7) / 8; }
+    size_t item_bytes(size_t layer) const { return xor_bytes(layer) + index_bytes; }
+    size_t ip_bytes() const { return 2 * index_bytes; }
+    size_t solution_width() const { return size_t(1) << k; }
+};
+
+// Fill `p` for (n, k); on failure `err` says which constraint is violated.
+// The constraints match the static_asserts of EquihashParamsT.
+inline bool rt_params_init(uint32_t n, uint32_t k, RtParams &p, std::string &err)
+{
+    if (k < 2)
+    {
+        err = "k must be at least 2";
+        return false;
+    }
+    if (n == 0 || n % (k + 1) != 0)
+    {
+        err = "n must be a positive multiple of k + 1";
+        return false;
+    }
+    if (n > 512)
+    {
+        err = "n must be at most 512 (one leaf per BLAKE2b output)";
+        return false;
+    }
+    p = RtParams{};
+    p.n = n;
+    p.k = k;
+    p.ell = n / (k + 1);
+    if (p.ell + 1 >= 32)
+    {
+        err = "leaf indices are 32-bit: 2^(n/(k+1)+1) leaves must fit";
+        return false;
+    }
+    p.leaves_per_hash = 512 / n;
+    p.hash_bytes = p.leaves_per_hash * ((n + 7) / 8);
+    if (p.hash_bytes > 64)
+    {
+        err = "one BLAKE2b output must hold 512/n leaves";
+        return false;
+    }
+    p.index_bytes = (p.ell + 2 + 7) / 8;
+    p.leaf_count = uint32_t(2) << p.ell;
+    p.hash_count = static_cast<uint32_t>((p.leaf_count + p.leaves_per_hash - 1) / p.leaves_per_hash);
+    p.max_list = size_t(p.leaf_count) + p.leaf_count / 20;
+    p.top_mask = (n % 8) ? static_cast<uint8_t>((1u << (n % 8)) - 1) : uint8_t(0xFF);
+    return true;
+}
+
+// Zcash BLAKE2b instance for run-time (n, k); the same midstate as
+// ZcashEquihashHasher::init_seed.
+struct RtHasher
+{
+    blake2b_state mid_;
+    size_t out_len = 0;
+
+    // Absorb `header` then the 32-byte `nonce`, as
+    // ZcashEquihashHasher::init_midstate.
+    void init_header(const RtParams &p, const uint8_t *header, size_t header_len, const uint8_t nonce[32])
+    {
+        out_len = p.hash_bytes;
+        blake2b_param P;
+        std::memset(&P, 0, sizeof(P));
+        P.digest_length = uint8_t(out_len);
+        P.fanout = 1;
+        P.depth = 1;
+        static const uint8_t ZPow[8] = {'Z', 'c', 'a', 's', 'h', 'P', 'o', 'W'};
+        std::memcpy(P.personal, ZPow, 8);
+        for (int i = 0; i < 4; ++i)
+        {
+            P.personal[8 + i] = uint8_t((p.n >> (8 * i)) & 0xFF);
+            P.personal[12 + i] = uint8_t((p.k >> (8 * i)) & 0xFF);
+        }
+        blake2b_init_param(&mid_, &P);
+        if (header && header_len)
+            blake2b_update(&mid_, header, header_len);
+        blake2b_update(&mid_, nonce, 32);
+    }
+
+    void init_seed(const RtParams &p, uint32_t seed)
+    {
+        uint8_t headernonce[140];
+        std::memset(headernonce, 0, sizeof(headernonce));
+        for (int i = 0; i < 4; ++i)
+            headernonce[108 + i] = uint8_t((seed >> (8 * i)) & 0xFF);
+        const uint8_t nonce[32] = {};
+        init_header(p, headernonce, sizeof(headernonce), nonce);
+    }
+
+    void hash_index(uint32_t idx, uint8_t *out) const
+    {
+        blake2b_state S = mid_;
+        uint8_t le[4] = {uint8_t(idx & 0xFF), uint8_t((idx >> 8) & 0xFF),
+                         uint8_t((idx >> 16) & 0xFF), uint8_t((idx >> 24) & 0xFF)};
+        blake2b_update(&S, le, 4);
+        blake2b_final(&S, out, out_len);
+    }
+};
+
+// Leaf `leaf` of the instance: its xor_bytes(0) bytes of hash leaf / lph.
+inline void rt_leaf(const RtParams &p, const RtHasher &H, uint32_t leaf, uint8_t *out)
+{
+    uint8_t h[64];
+    H.hash_index(static_cast<uint32_t>(leaf / p.leaves_per_hash), h);
+    const size_t w = p.xor_bytes(0);
+    std::memcpy(out, h + (leaf % p.leaves_per_hash) * w, w);
+    out[w - 1] &= p.top_mask;
+}
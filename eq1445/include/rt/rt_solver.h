@@ -0,0 +1,296 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "core/solution_set.h"
+#include "rt/rt_kernels.h"
+#include "rt/rt_params.h"
+
+// ------------------ Run-time CIP / CIP-PR ------------------
+// Wagner rounds over RtLayer records for an (n, k) chosen at run time. Each
+// round radix-sorts the layer into the other item buffer and collides it
+// back, so the item layers ping-pong between two buffers of
+// max_list * item_bytes(0) bytes instead of merging in place; IP layers
+// are laid out as in plain_cip.
+//
+//   CIP    arena: [items A][items B][IP1 .. IP{k-1}]
+//   CIP-PR arena: [items A][items B]  (IP{h} recomputed from layer 0)
+//
+// The final IP layer is written to whichever item buffer is free.
+
+inline uint64_t rt_item_buffer_bytes(const RtParams &p)
+{
+    return static_cast<uint64_t>(p.max_list) * p.item_bytes(0);
+}
+
+inline uint64_t rt_ip_layer_bytes(const RtParams &p)
+{
+    return static_cast<uint64_t>(p.max_list) * p.ip_bytes();
+}
+
+inline uint64_t rt_cip_peak_memory(const RtParams &p)
+{
+    return 2 * rt_item_buffer_bytes(p) + (p.k - 1) * rt_ip_layer_bytes(p);
+}
+
+inline uint64_t rt_cip_pr_peak_memory(const RtParams &p)
+{
+    return 2 * rt_item_buffer_bytes(p);
+}
+
+inline unsigned rt_round_bits(const RtParams &p, size_t round)
+{
+    return static_cast<unsigned>(round + 1 == p.k ? 2 * p.ell : p.ell);
+}
+
+inline RtLayer rt_fill_layer0(const RtParams &p, const RtHasher &H, uint8_t *buf, size_t bytes)
+{
+    RtLayer L = rt_init_layer(buf, bytes, p.item_bytes(0));
+    const size_t w = p.xor_bytes(0);
+    uint8_t out[64];
+    for (uint32_t h = 0; h < p.hash_count; ++h)
+    {
+        H.hash_index(h, out);
+        for (size_t j = 0; j < p.leaves_per_hash; ++j)
+        {
+            const uint32_t leaf = static_cast<uint32_t>(h * p.leaves_per_hash + j);
+            if (leaf >= p.leaf_count)
+                break;
+            uint8_t *rec = L.at(L.size++);
+            std::memcpy(rec, out + j * w, w);
+            rec[w - 1] &= p.top_mask;
+            rt_set_index(rec + w, p.index_bytes, leaf);
+        }
+    }
+    return L;
+}
+
+// One round on `src`, sorted by its round key: every pair inside a group of
+// equal keys gets the next IP position; below the final round its XOR,
+// shifted by ell, becomes the item at that position of the next layer. As
+// in merge_ip_inplace_generic, a pair whose XOR is zero marks its second
+// item as a duplicate, and final groups of more than 3 are skipped. `dst`
+// may be null when only the IP layer is wanted and `ip` null when only the
+// items are; positions match either way. The final round (k-1) collides on
+// 2*ell bits and only emits IP pairs.
+inline size_t rt_collide(const RtParams &p, size_t round, const RtLayer &src, RtLayer *dst, RtLayer *ip)
+{
+    const bool last = round + 1 == p.k;
+    const size_t in_len = p.xor_bytes(round);
+    const size_t out_len = last ? 0 : p.xor_bytes(round + 1);
+    const unsigned bits = rt_round_bits(p, round);
+    const RtMergeFn merge = rt_pick_merge(in_len);
+    const size_t ib = p.index_bytes;
+    uint8_t tmp[64 + 4];
+    std::vector<uint8_t> skip;
+    size_t emitted = 0;
+
+    for (size_t g = 0; g < src.size;)
+    {
+        const uint64_t key = rt_key(src.at(g), in_len, bits);
+        size_t e = g + 1;
+        while (e < src.size && rt_key(src.at(e), in_len, bits) == key)
+            ++e;
+        if (last && e - g > 3)
+        {
+            g = e; // as merge_*_generic: large final groups are skipped
+            continue;
+        }
+        skip.assign(e - g, 0);
+        for (size_t i = g; i < e; ++i)
+        {
+            if (skip[i - g])
+                continue;
+            for (size_t j = i + 1; j < e; ++j)
+            {
+                if (skip[j - g])
+                    continue;
+                if (emitted >= p.max_list)
+                    return emitted;
+                const uint8_t *a = src.at(i), *b = src.at(j);
+                if (!last)
+                {
+                    uint8_t *out = dst ? dst->at(dst->size) : tmp;
+                    merge(out, a, b, in_len, out_len, static_cast<unsigned>(p.ell));
+                    bool zero = true; // is_zero_item: the leading 5 bytes
+                    for (size_t t = 0; t < std::min<size_t>(out_len, 5) && zero; ++t)
+                        zero = out[t] == 0;
+                    if (zero)
+                    {
+                        skip[j - g] = 1; // j duplicates i
+                        continue;
+                    }
+                    rt_set_index(out + out_len, ib, static_cast<uint32_t>(emitted));
+                    if (dst)
+                        ++dst->size;
+                }
+                if (ip)
+                {
+                    uint8_t *q = ip->at(ip->size++);
+                    std::memcpy(q, a + in_len, ib);
+                    std::memcpy(q + ib, b + in_len, ib);
+                }
+                ++emitted;
+            }
+        }
+        g = e;
+    }
+    return emitted;
+}
+
+// Rounds 0..last from a fresh layer 0 in item buffers `a` and `b`. Round i
+// writes IP{i+1} to ips[i] when `ips` is given; the IP layer of round
+// `last` always goes to the item buffer left free and is returned. Layer
+// sizes are logged when `verbose`.
+inline RtLayer rt_forward(const RtParams &p, const RtHasher &H, uint8_t *a, uint8_t *b,
+                          size_t buf_bytes, size_t last, RtLayer *ips, bool verbose = false)
+{
+    RtLayer S = rt_fill_layer0(p, H, a, buf_bytes);
+    for (size_t i = 0;; ++i)
+    {
+        S = rt_sort_by_key(S, S.data == a ? b : a, p.xor_bytes(i), rt_round_bits(p, i));
+        uint8_t *other = S.data == a ? b : a;
+        if (i == last)
+        {
+            RtLayer IP = rt_init_layer(other, buf_bytes, p.ip_bytes());
+            rt_collide(p, i, S, nullptr, &IP);
+            return IP;
+        }
+        RtLayer D = rt_init_layer(other, buf_bytes, p.item_bytes(i + 1));
+        rt_collide(p, i, S, &D, ips ? &ips[i] : nullptr);
+        if (verbose)
+        {
+            std::cout << "Layer " << i + 1 << " size: " << D.size << std::endl;
+        }
+        S = D;
+    }
+}
+
+// Start the solutions from the final IP layer.
+inline void rt_expand_init(const RtParams &p, SolutionSet &solutions, const RtLayer &ip)
+{
+    const size_t ib = p.index_bytes;
+    solutions.init(ip.size, [&](size_t i, uint32_t &left, uint32_t &right)
+                   {
+                       left = rt_get_index(ip.at(i), ib);
+                       right = rt_get_index(ip.at(i) + ib, ib); });
+}
+
+// One backward round through `ip`, in ascending IP order (see SolutionSet).
+inline void rt_expand(const RtParams &p, SolutionSet &solutions, const RtLayer &ip, std::vector<uint64_t> &keys)
+{
+    const size_t ib = p.index_bytes;
+    solutions.ref_order(keys);
+    for (uint64_t key : keys)
+    {
+        const uint8_t *q = ip.at(SolutionSet::ref_of(key));
+        solutions.put(key, rt_get_index(q, ib), rt_get_index(q + ib, ib));
+    }
+    solutions.widen();
+}
+
+// Both solvers log layer sizes to stdout when `verbose`.
+inline SolutionSet rt_cip(const RtParams &p, const RtHasher &H, uint8_t *base, bool verbose = false)
+{
+    const uint64_t item = rt_item_buffer_bytes(p), ipl = rt_ip_layer_bytes(p);
+    std::vector<RtLayer> ips(p.k - 1);
+    for (size_t j = 0; j + 1 < p.k; ++j)
+    {
+        ips[j] = rt_init_layer(base + 2 * item + j * ipl, ipl, p.ip_bytes());
+    }
+
+    RtLayer IPK = rt_forward(p, H, base, base + item, item, p.k - 1, ips.data(), verbose);
+    if (verbose)
+    {
+        std::cout << "Layer " << p.k << " IP size: " << IPK.size << std::endl;
+    }
+
+    SolutionSet solutions(p.solution_width());
+    rt_expand_init(p, solutions, IPK);
+    std::vector<uint64_t> keys;
+    for (size_t j = p.k - 1; j >= 1 && !solutions.empty(); --j)
+    {
+        rt_expand(p, solutions, ips[j - 1], keys);
+    }
+    return solutions;
+}
+
+inline SolutionSet rt_cip_pr(const RtParams &p, const RtHasher &H, uint8_t *base, bool verbose = false)
+{
+    const uint64_t item = rt_item_buffer_bytes(p);
+
+    RtLayer IPK = rt_forward(p, H, base, base + item, item, p.k - 1, nullptr, verbose);
+    if (verbose)
+    {
+        std::cout << "Layer " << p.k << " IP size: " << IPK.size << std::endl;
+    }
+
+    SolutionSet solutions(p.solution_width());
+    rt_expand_init(p, solutions, IPK);
+    std::vector<uint64_t> keys;
+    for (size_t h = p.k - 1; h >= 1 && !solutions.empty(); --h)
+    {
+        // Rounds 0..h-1 rebuild IP{h} into a free item buffer.
+        RtLayer IPh = rt_forward(p, H, base, base + item, item, h - 1, nullptr);
+        rt_expand(p, solutions, IPh, keys);
+    }
+    return solutions;
+}
+
+// Whether `sol` (solution_width() leaf indices) is a valid non-trivial
+// solution, with the checks of BatchVerifier: every 2^r-leaf subtree XORs
+// to zero on its low r*ell bits and the root is zero. `work` and `scratch`
+// are reused across calls.
+inline bool rt_solution_valid(const RtParams &p, const RtHasher &H, const uint32_t *sol,
+                              std::vector<uint8_t> &work, std::vector<uint32_t> &scratch)
+{
+    const size_t w = p.xor_bytes(0);
+    const size_t width = p.solution_width();
+    if (solution_is_trivial(sol, width, scratch))
+        return false;
+    work.resize(width * w);
+    bool ok = true;
+    for (size_t j = 0; j < width && ok; ++j)
+    {
+        ok = sol[j] < p.leaf_count;
+        if (ok)
+            rt_leaf(p, H, sol[j], &work[j * w]);
+    }
+    for (size_t r = 1; r <= p.k && ok; ++r)
+    {
+        const size_t nodes = width >> r;
+        const size_t zero_bits = r < p.k ? r * p.ell : w * 8;
+        for (size_t i = 0; i < nodes && ok; ++i)
+        {
+            uint8_t *x = &work[i * w];
+            const uint8_t *l = &work[2 * i * w], *rr = &work[(2 * i + 1) * w];
+            for (size_t t = 0; t < w; ++t)
+                x[t] = l[t] ^ rr[t];
+            const size_t by = std::min(zero_bits / 8, w);
+            for (size_t t = 0; t < by && ok; ++t)
+                ok = x[t] == 0;
+            if (ok && by < w && zero_bits % 8)
+                ok = (x[by] & ((1u << (zero_bits % 8)) - 1)) == 0;
+        }
+    }
+    return ok;
+}
+
+// Valid (non-trivial) solutions in `solutions`.
+inline size_t rt_verify(const RtParams &p, const RtHasher &H, const SolutionSet &solutions)
+{
+    std::vector<uint8_t> work;
+    std::vector<uint32_t> scratch;
+    size_t valid = 0;
+    for (size_t s = 0; s < solutions.size(); ++s)
+    {
+        if (solutions.width() == p.solution_width())
+            valid += rt_solution_valid(p, H, solutions[s], work, scratch);
+    }
+    return valid;
+}
@@ -0,0 +1,84 @@
+#ifndef WAGNER_H
+#define WAGNER_H
+
+/* ------------------ libwagner: embeddable Equihash solver ------------------
+ * C ABI over the run-time (n, k) solvers (rt/rt_context.h). A context owns
+ * its arena, which is reused across calls and only grows; contexts are
+ * independent, so several can solve at once on different threads. One
+ * context must not be used by two threads at the same time.
+ *
+ *   wagner_ctx *ctx = wagner_ctx_create();
+ *   wagner_params params = {200, 9};
+ *   int found = wagner_solve(ctx, header, 108, nonce, params,
+ *                            WAGNER_MODE_AUTO, 256u << 20, on_solution, user);
+ *   ...
+ *   wagner_ctx_destroy(ctx);
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define WAGNER_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#define WAGNER_API __attribute__((visibility("default")))
+#else
+#define WAGNER_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct wagner_ctx wagner_ctx;
+
+typedef struct wagner_params
+{
+    uint32_t n;
+    uint32_t k;
+} wagner_params;
+
+typedef enum wagner_mode
+{
+    WAGNER_MODE_AUTO = 0,  /* CIP if it fits the budget, otherwise CIP-PR */
+    WAGNER_MODE_CIP = 1,   /* all IP layers in RAM */
+    WAGNER_MODE_CIP_PR = 2 /* IP layers recomputed during the expansion */
+} wagner_mode;
+
+/* Error codes returned by wagner_solve (negative). */
+#define WAGNER_ERR_PARAMS (-1)  /* (n, k) not supported */
+#define WAGNER_ERR_MODE (-2)    /* unknown mode */
+#define WAGNER_ERR_BUDGET (-3)  /* the mode needs more than `budget` bytes */
+#define WAGNER_ERR_NOMEM (-4)   /* arena allocation failed */
+#define WAGNER_ERR_ARG (-5)     /* null context or nonce */
+#define WAGNER_ERR_INTERNAL (-6) /* unexpected failure inside the solver */
+
+/* Called once per valid solution with its 2^k leaf indices. Return 0 to
+ * continue, nonzero to stop delivering solutions of this call. */
+typedef int (*wagner_solution_cb)(const uint32_t *indices, size_t count, void *user);
+
+WAGNER_API wagner_ctx *wagner_ctx_create(void);
+WAGNER_API void wagner_ctx_destroy(wagner_ctx *ctx);
+
+/* Solve the instance BLAKE2b(header || nonce) for `params`. `budget` caps
+ * the arena in bytes (0: no limit). Returns the number of solutions passed
+ * to `cb` (which may be null), or a WAGNER_ERR_* code. */
+WAGNER_API int wagner_solve(wagner_ctx *ctx, const uint8_t *header, size_t header_len,
+                            const uint8_t nonce[32], wagner_params params, wagner_mode mode,
+                            uint64_t budget, wagner_solution_cb cb, void *user);
+
+/* Arena bytes `mode` needs for `params` (0 if unsupported). AUTO counts as
+ * CIP. */
+WAGNER_API uint64_t wagner_peak_memory(wagner_params params, wagner_mode mode);
+
+/* Arena bytes currently held by `ctx`. */
+WAGNER_API uint64_t wagner_ctx_arena_bytes(const wagner_ctx *ctx);
+
+/* Message of the last failed call on `ctx`; empty after a success. */
+WAGNER_API const char *wagner_last_error(const wagner_ctx *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WAGNER_H */
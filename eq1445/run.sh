@@ -1,7 +1,8 @@
 #!/bin/bash
 # Unified benchmark script for Equihash CIP variants + Tromp baseline
-# Usage: ./run.sh [-x4] [--iters N] [--seed S] [--variant=200_9|144_5]
+# Usage: ./run.sh [-x4|-x8] [--iters N] [--seed S] [--variant=200_9|144_5]
 #        -x4       Enable 4-way BLAKE2b SIMD optimized build (requires AVX2, 200_9 only)
+#        -x8       Same with the 8-way BLAKE2b kernel
 #        --iters N Number of iterations (default 5)
 #        --seed S  Starting seed (default 0)
 #        --variant Select parameter set (default 200_9)
@@ -14,13 +15,15 @@ BOLD='\033[1m'
 ITERS=2
 SEED=42
 X4_MODE=false
+LANES=4
 VARIANT="200_9"
 USSMON_INTERVAL=${USSMON_INTERVAL:-0.01}
 
 # Parse args
 while [[ $# -gt 0 ]]; do
   case "$1" in
-    -x4) X4_MODE=true; shift ;;
+    -x4) X4_MODE=true; LANES=4; shift ;;
+    -x8) X4_MODE=true; LANES=8; shift ;;
     --iters) ITERS="$2"; shift 2 ;;
     --seed) SEED="$2"; shift 2 ;;
     --variant) VARIANT="$2"; shift 2 ;;
@@ -43,10 +46,10 @@ case "$VARIANT" in
   200_9)
     VARIANT_LABEL="Equihash(200,9)"
     if $X4_MODE; then
-      MAIN_BIN="apr_x41"
-      EM_FILE="./ip_cache_x41.bin"
-      TROMP_TARGET="equix41"
-      TROMP_BIN="equix41"
+      MAIN_BIN="apr_x${LANES}1"
+      EM_FILE="./ip_cache_x${LANES}1.bin"
+      TROMP_TARGET="equix${LANES}1"
+      TROMP_BIN="equix${LANES}1"
     else
       MAIN_BIN="apr_200_9"
       EM_FILE="./ip_cache.bin"
@@ -57,7 +60,7 @@ case "$VARIANT" in
   144_5)
     VARIANT_LABEL="Equihash(144,5)"
     if $X4_MODE; then
-      echo -e "${YELLOW}Warning: -x4 is only available for Equihash(200,9); running standard build instead.${NC}"
+      echo -e "${YELLOW}Warning: -x${LANES} is only available for Equihash(200,9); running standard build instead.${NC}"
       X4_MODE=false
     fi
     MAIN_BIN="apr_144_5"
@@ -86,9 +89,9 @@ fi
 print_header() {
   local mode_note=""
   if $X4_MODE; then
-    mode_note="${MAGENTA}Mode: 4-way BLAKE2b SIMD (AVX2 required)${NC}"
+    mode_note="${MAGENTA}Mode: ${LANES}-way BLAKE2b SIMD (AVX2 required)${NC}"
     if ! grep -qi avx2 /proc/cpuinfo 2>/dev/null; then
-      echo -e "${RED}Warning: AVX2 not detected -> 4-way SIMD may not run optimally.${NC}"
+      echo -e "${RED}Warning: AVX2 not detected -> ${LANES}-way SIMD may not run optimally.${NC}"
     fi
   else
     mode_note="${CYAN}Mode: Standard BLAKE2b${NC}"
@@ -1,11 +1,13 @@
 #!/bin/bash
 # Lightweight benchmark for Equihash CIP-APR switching height curve
-# Usage: ./run_apr_curve.sh [--nk 144_5|200_9] [--seed S] [--iters N] [--heights "0 1 2 3 4 ..."]
+# Usage: ./run_apr_curve.sh [--nk 144_5|200_9] [--seed S] [--iters N] [--heights "0 1 2 3 4 ..."] [--lsr "1 2 4 ..."]
 #        --nk      Which Equihash params to use: 144_5 or 200_9 (default 144_5)
 #        --seed    Starting seed (default 0)
 #        --iters   Number of iterations per height (default 1)
 #        --heights Space-separated list of switching heights to test
 #                  default: "0 1 2 3 4" for 144_5, "0 1 2 3 4 5 6 7 8" for 200_9
+#        --lsr     Space-separated list of LSR reduction factors q (powers of two) to
+#                  measure on the same binary after the APR points (default: none)
 set -e
 
 RED='\033[0;31m'; GREEN='\033[0;32m'; YELLOW='\033[1;33m'; BLUE='\033[0;34m'; CYAN='\033[36m'; NC='\033[0m'
@@ -16,6 +18,7 @@ SEED=0
 ITERS=1
 HEIGHTS=""
 HEIGHTS_SET=0       # Tracks whether --heights was explicitly provided
+LSR_QS=""
 
 # Parse args
 while [[ $# -gt 0 ]]; do
@@ -37,6 +40,10 @@ while [[ $# -gt 0 ]]; do
       HEIGHTS_SET=1
       shift 2
       ;;
+    --lsr)
+      LSR_QS="$2"
+      shift 2
+      ;;
     -h|--help)
       grep '^# Usage:' "$0" | sed 's/^# //' 
       exit 0
@@ -166,6 +173,29 @@ for h in $HEIGHTS; do
   RESULTS+=("${h}|${TIME_S}|${TOTAL_SOLS}|${SOL_PER_SEC}|${PEAK_USS}|${PEAK_MB}")
 done
 
+for q in $LSR_QS; do
+  echo -ne "${CYAN}[q=${q}]${NC} Running LSR, ${ITERS} iteration(s)... "
+
+  measure_uss_and_capture_output ./build/${MAIN_BIN} --mode=lsr --lsr-q=${q} --seed=${SEED} --iters=${ITERS}
+  OUTPUT="$RUN_OUTPUT"
+  PEAK_USS="$MAX_USS_KB"
+
+  TOTAL_SOLS=$(echo "$OUTPUT" | grep "total_sols=" | sed -E 's/.*total_sols=([0-9]+).*/\1/')
+  TIME_S=$(echo "$OUTPUT" | grep "single_run_time=" | sed -E 's/.*single_run_time=([0-9.]+).*/\1/')
+  SOL_PER_SEC=$(echo "$OUTPUT" | grep "Sol/s=" | sed -E 's/.*Sol\/s=([0-9.]+).*/\1/')
+
+  [ -z "$PEAK_USS" ] && PEAK_USS=0
+  [ -z "$TOTAL_SOLS" ] && TOTAL_SOLS=0
+  [ -z "$TIME_S" ] && TIME_S=0
+  [ -z "$SOL_PER_SEC" ] && SOL_PER_SEC=0
+
+  PEAK_MB=$(awk -v v="$PEAK_USS" 'BEGIN{printf "%.1f", v/1024}')
+
+  echo -e "Done. ${GREEN}sols=${TOTAL_SOLS}${NC} time=${TIME_S}s sol/s=${SOL_PER_SEC} USS=${PEAK_MB}MB"
+
+  RESULTS+=("lsr:${q}|${TIME_S}|${TOTAL_SOLS}|${SOL_PER_SEC}|${PEAK_USS}|${PEAK_MB}")
+done
+
 echo ""
 echo -e "${GREEN}${BOLD}Results Summary${NC}"
 echo -e "${YELLOW}────────────────────────────────────────────────────────${NC}"
@@ -174,7 +204,9 @@ printf "%-8s %12s %10s %10s %15s %12s\n" "--------" "------------" "----------"
 
 for r in "${RESULTS[@]}"; do
   IFS='|' read -r h time sols solps uss mb <<< "$r"
-  printf "%-8s %12s %10s %10s %15s %12s\n" "h=${h}" "${time}" "${sols}" "${solps}" "${uss}" "${mb}"
+  label="h=${h}"
+  [[ "$h" == lsr:* ]] && label="q=${h#lsr:}"
+  printf "%-8s %12s %10s %10s %15s %12s\n" "${label}" "${time}" "${sols}" "${solps}" "${uss}" "${mb}"
 done
 
 echo ""
@@ -183,5 +215,8 @@ echo "  - Higher switching_height = lower memory, longer time (more recomputatio
 echo "  - h=0: No partial recomputation (baseline memory)"
 echo "  - h=${HMAX}: Maximum recomputation (minimum memory) for Equihash(${NVAL},${KVAL})"
 echo "  - Valid h range: 0 .. ${HMAX}"
+if [ -n "$LSR_QS" ]; then
+  echo "  - q=Q: LSR with lists cut to 1/q over q runs; q=1 is plain CIP"
+fi
 
 echo -e "${GREEN}Benchmark complete.${NC}"
@@ -0,0 +1,761 @@
+#include "common/apr_alg_common.h"
+#include "core/civ.h"
+#include "core/hybrid.h"
+#include "core/ip_plan.h"
+#include "core/run_store.h"
+#include "core/search.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ------------------ Shared APR solvers ------------------
+// The modes every variant runs the same way, written against the Layer<I> /
+// LayerIDX<I> templates; the variants' apr_alg.cpp hold the hand-unrolled
+// ones (see common/apr_solvers.h).
+
+uint64_t MAX_IP_MEM_BYTES = static_cast<uint64_t>(MAX_LIST_SIZE) * sizeof(Item_IP);
+uint64_t MAX_ITEM_MEM_BYTES = static_cast<uint64_t>(MAX_LIST_SIZE) * sizeof(Item0_IDX);
+
+SortAlgo g_sort_algo = SortAlgo::KXSORT;
+bool g_verbose = true;
+IPDiskFormat g_em_format = IPDiskFormat::RAW;
+bool g_em_direct = false;
+
+bool g_pr_checkpoints = true;
+uint64_t g_pr_ckpt_bytes = 0; // extra arena for plain_cip_pr checkpoints
+bool g_pr_sparse = true;
+unsigned g_verify_threads = 0; // 0 = one per core
+const ZcashHeaderPrefix *g_header = nullptr; // --header: seeds are nonce counters over it
+
+uint64_t plain_cip_pr_peak_memory()
+{
+    return MAX_ITEM_MEM_BYTES + (g_pr_checkpoints ? g_pr_ckpt_bytes : 0);
+}
+
+// ---- CIP-APR ----
+// Every switching height runs on CipStepper, stepped until done; h = K-1
+// is plain_cip_pr. The arena is the variant's advanced_cip_pr_peak_memory.
+SolutionSet run_advanced_cip_pr(int seed, int h, uint8_t *base)
+{
+    constexpr int K = EquihashParams::K;
+    if (h < 0 || h >= K)
+    {
+        std::cerr << "Unsupported switching height: " << h
+                  << " (must be 0-" << K - 1 << " for Equihash " << EQ_VARIANT << ")" << std::endl;
+        return {};
+    }
+    const uint64_t total_mem = advanced_cip_pr_peak_memory(h);
+    bool own_base = false;
+    if (!base)
+    {
+        base = static_cast<uint8_t *>(std::malloc(total_mem));
+        own_base = true;
+    }
+    IFV
+    {
+        std::cout << "Total memory allocated (MB): " << total_mem / (1024 * 1024) << " (h=" << h << ")" << std::endl;
+    }
+
+    CipStepper solver(seed, h, base, total_mem, g_pr_checkpoints, g_pr_sparse);
+    while (!solver.done())
+    {
+        solver.step();
+    }
+    SolutionSet solutions = std::move(solver.solutions());
+
+    if (own_base)
+    {
+        std::free(base);
+    }
+    return solutions;
+}
+
+SolutionSet plain_cip_pr(int seed, uint8_t *base)
+{
+    return run_advanced_cip_pr(seed, EquihashParams::K - 1, base);
+}
+
+// ---- Out-of-core CIP-EM ----
+// Item layers live on disk as key-prefix partitions (PartitionedRun) and are
+// merged one partition at a time in a work area sized by the RAM budget; IP
+// layers go to the EM store exactly as in cip_em. An output item's index is
+// its position in the IP layer being written, so partitions can be emitted
+// in any order.
+
+struct OOCContext
+{
+    EquihashIPDiskWriter &writer;
+    IPDiskManifest &manifest;
+    OOCPlan plan;
+    uint8_t *work;    // one partition (plan.work_bytes)
+    uint8_t *run_buf; // output buffers of the run being written
+    size_t run_bytes;
+    std::string run_path;
+    std::vector<Item_IP> final_ips;
+    uint64_t dropped = 0; // items beyond a partition's work area
+};
+
+// Items that can collide share their collision key, hence its top bits.
+template <typename T>
+inline size_t ooc_part_of(const T &item, unsigned bits)
+{
+    return bits ? static_cast<size_t>(get_collision_key(item) >> (EquihashParams::kCollisionBitLength - bits)) : 0;
+}
+
+inline size_t ooc_max_part_bits()
+{
+    return std::min<size_t>(EquihashParams::kCollisionBitLength, 12);
+}
+
+inline OOCPlan cip_ooc_plan(size_t mem_budget, size_t stripes)
+{
+    return ooc_plan(MAX_LIST_SIZE, sizeof(Item0_IDX), mem_budget,
+                    em_staging_bytes<Item_IP>(g_em_direct, stripes),
+                    PartitionedRun<Item0_IDX>::buffer_bytes(1),
+                    static_cast<unsigned>(ooc_max_part_bits()), 4);
+}
+
+uint64_t cip_ooc_peak_memory(size_t mem_budget, size_t stripes)
+{
+    const OOCPlan plan = cip_ooc_plan(mem_budget, stripes);
+    return plan.work_bytes + em_staging_bytes<Item_IP>(g_em_direct, stripes) +
+           PartitionedRun<Item0_IDX>::buffer_bytes(plan.parts);
+}
+
+// Load partition `p` of `src` into the work area; returns false on I/O error.
+template <size_t I>
+inline bool ooc_load_part(PartitionedRun<ItemIDX<I>> &src, size_t p, LayerIDX<I> &S, OOCContext &ctx)
+{
+    const size_t n = static_cast<size_t>(std::min<uint64_t>(src.part_size(p), S.capacity()));
+    ctx.dropped += src.part_size(p) - n;
+    S.resize(n);
+    return src.read_part(p, S.data(), n);
+}
+
+template <size_t I>
+inline bool ooc_forward(PartitionedRun<ItemIDX<I>> &src, OOCContext &ctx)
+{
+    if constexpr (I + 1 == EquihashParams::K)
+    {
+        // Last hop: only the final IP pairs are kept, in RAM.
+        for (size_t p = 0; p < src.parts(); ++p)
+        {
+            LayerIDX<I> S = init_layer<ItemIDX<I>>(ctx.work, ctx.plan.work_bytes);
+            Layer_IP F = init_layer<Item_IP>(ctx.work, ctx.plan.work_bytes);
+            if (!ooc_load_part<I>(src, p, S, ctx))
+                return false;
+            merge_inplace_for_ip<I>(S, F);
+            ctx.final_ips.insert(ctx.final_ips.end(), F.begin(), F.end());
+            if (F.size() == F.capacity())
+            {
+                // F may have overflowed; the merge overwrote S, so reload the
+                // partition and count every pair it yields.
+                const size_t kept = F.size();
+                if (!src.read_part(p, S.data(), S.size()))
+                    return false;
+                std::vector<Item_IP> none;
+                const size_t pairs = merge_for_ip_sparse<I>(S, SIZE_MAX, {SIZE_MAX}, none);
+                ctx.dropped += pairs - kept;
+            }
+        }
+        src.remove();
+        return true;
+    }
+    else
+    {
+        PartitionedRun<ItemIDX<I + 1>> dst;
+        if (!dst.create(ctx.run_path + std::to_string(I + 1), ctx.plan.parts, ctx.run_buf, ctx.run_bytes))
+            return false;
+        const uint64_t ip_start = ctx.writer.get_current_offset() / sizeof(Item_IP);
+        ctx.manifest.ip[I].offset = ip_start * sizeof(Item_IP);
+        for (size_t p = 0; p < src.parts(); ++p)
+        {
+            LayerIDX<I> S = init_layer<ItemIDX<I>>(ctx.work, ctx.plan.work_bytes);
+            LayerIDX<I + 1> D = init_layer<ItemIDX<I + 1>>(ctx.work, ctx.plan.work_bytes);
+            if (!ooc_load_part<I>(src, p, S, ctx))
+                return false;
+            const uint64_t ip_base = ctx.writer.get_current_offset() / sizeof(Item_IP) - ip_start;
+            merge_em_ip_inplace<I>(S, D, ctx.writer);
+            // Pairs past D's capacity still reach the IP file but nothing
+            // refers to them: count them as dropped.
+            const uint64_t pushed = ctx.writer.get_current_offset() / sizeof(Item_IP) - ip_start - ip_base;
+            ctx.dropped += pushed - D.size();
+            for (size_t j = 0; j < D.size(); ++j)
+            {
+                set_index(D[j], ip_base + j);
+                dst.append(ooc_part_of(D[j], ctx.plan.part_bits), D[j]);
+            }
+        }
+        if (!dst.finish())
+            return false;
+        ctx.manifest.ip[I].count = ctx.writer.get_current_offset() / sizeof(Item_IP) - ip_start;
+        src.remove();
+        IFV { std::cout << "Layer " << I + 1 << " size: " << dst.size()
+                        << " (largest partition " << dst.max_part_size() << ")" << std::endl; }
+        return ooc_forward<I + 1>(dst, ctx);
+    }
+}
+
+SolutionSet cip_ooc(int seed, const std::string &em_path, size_t mem_budget, uint8_t *base, uint64_t *dropped)
+{
+    // Arena: [partition work area][EM staging][run output buffers]
+    const std::vector<std::string> em_files = em_split_paths(em_path, "ip_cache_" EQ_VARIANT ".bin");
+    const OOCPlan plan = cip_ooc_plan(mem_budget, em_files.size());
+    const size_t em_bytes = em_staging_bytes<Item_IP>(g_em_direct, em_files.size());
+    const size_t run_bytes = PartitionedRun<Item0_IDX>::buffer_bytes(plan.parts);
+    const size_t total_mem = plan.work_bytes + em_bytes + run_bytes;
+    bool own_base = false;
+    if (!base)
+    {
+        base = static_cast<uint8_t *>(std::malloc(total_mem));
+        own_base = true;
+    }
+    IFV
+    {
+        std::cout << "Total memory allocated (MB): " << total_mem / (1024 * 1024)
+                  << ", partitions: " << plan.parts
+                  << ", work area (MB): " << plan.work_bytes / (1024 * 1024) << std::endl;
+    }
+
+    IPDiskManifest manifest{};
+    EquihashIPDiskWriter writer;
+    writer.attach_staging(base + plan.work_bytes, em_bytes);
+    writer.set_format(g_em_format);
+    writer.set_direct(g_em_direct);
+    if (!writer.open(em_files))
+    {
+        std::cerr << "Failed to open EM file: " << em_path << std::endl;
+        if (own_base)
+        {
+            std::free(base);
+        }
+        return {};
+    }
+
+    OOCContext ctx{writer, manifest, plan, base, base + plan.work_bytes + em_bytes, run_bytes,
+                   em_files[0] + ".run", {}, 0};
+
+    // Layer 0 is generated straight into its partitions.
+    bool ok;
+    {
+        PartitionedRun<Item0_IDX> L0;
+        ok = L0.create(ctx.run_path + "0", plan.parts, ctx.run_buf, run_bytes);
+        if (ok)
+        {
+            constexpr size_t XOR_SLICE = ItemXorSize<Item0_IDX>;
+            for_each_leaf(seed, [&](size_t leaf, const uint8_t *x)
+                          {
+                              Item0_IDX a;
+                              std::memcpy(a.XOR, x, XOR_SLICE);
+                              set_index(a, leaf);
+                              L0.append(ooc_part_of(a, plan.part_bits), a); });
+            ok = L0.finish() && ooc_forward<0>(L0, ctx);
+        }
+    }
+    if (ctx.dropped)
+    {
+        std::cerr << "Warning: cip-ooc dropped " << ctx.dropped
+                  << " items beyond partition capacity (raise --ooc-mem)" << std::endl;
+    }
+    if (dropped)
+        *dropped = ctx.dropped;
+
+    manifest.blocks = writer.block_index();
+    manifest.stripes = writer.stripe_map();
+    writer.close();
+
+    SolutionSet solutions;
+    if (ok && !ctx.final_ips.empty())
+    {
+        // The work area is free again: stage the final pairs there.
+        Layer_IP IPK = init_layer<Item_IP>(base, plan.work_bytes);
+        const size_t n = std::min(ctx.final_ips.size(), IPK.capacity());
+        IPK.insert(IPK.end(), ctx.final_ips.begin(), ctx.final_ips.begin() + n);
+
+        EquihashIPDiskReader reader;
+        reader.attach_staging(base + plan.work_bytes, em_bytes);
+        reader.set_direct(g_em_direct);
+        if (!reader.open(em_files))
+        {
+            std::cerr << "Cannot open EM file for reading\n";
+            if (own_base)
+            {
+                std::free(base);
+            }
+            return solutions;
+        }
+        reader.set_block_index(&manifest.blocks);
+        reader.set_stripe_map(&manifest.stripes);
+
+        expand_solutions(solutions, IPK);
+        for (int i = static_cast<int>(EquihashParams::K) - 2; i >= 0; --i)
+        {
+            expand_solutions_from_file(solutions, reader, manifest.ip[i]);
+        }
+        reader.close();
+    }
+
+    if (own_base)
+    {
+        std::free(base);
+    }
+    return solutions;
+}
+
+// ---- Per-layer IP plan ----
+// Runs any IPPlan: each IP layer is kept in RAM, spilled to the EM store or
+// recomputed with recover_IP during expansion. Item layers below the lowest
+// kept IP layer run without indices (as below h in advanced_cip_pr); a
+// recomputed layer above it is still merged with indices, its pairs dropped.
+//
+// Arena: [item layers ->        <- RAM IPs | EM staging]
+// RAM IP layers are stacked down from the staging area in the order they are
+// produced, so the item region shrinks as they accumulate. recover_IP only
+// touches the first MAX_ITEM_MEM_BYTES, and RAM layers still needed at that
+// point (those below the recomputed one) must sit beyond it.
+
+struct PlanContext
+{
+    const IPPlan &plan;
+    size_t lowest_kept; // lowest IP layer (1-based) that is not recomputed
+    uint8_t *base;
+    std::vector<Layer_IP> &ram_ips;
+    std::array<int, EquihashParams::K> ram_slot; // IP layer -> ram_ips index, -1 if not in RAM
+    EquihashIPDiskWriter &writer;
+    IPDiskManifest &manifest;
+    Layer_IP &ip_last;
+};
+
+uint64_t cip_plan_peak_memory(const IPPlan &plan, size_t stripes)
+{
+    constexpr size_t K = EquihashParams::K;
+    const size_t lo = ip_plan_lowest_kept(plan);
+    if (lo >= K)
+    {
+        return plain_cip_pr_peak_memory();
+    }
+    const uint64_t em_bytes = ip_plan_has(plan, IPPolicy::SPILL) ? em_staging_bytes<Item_IP>(g_em_direct, stripes) : 0;
+
+    // Forward: merging layer j holds layer j (indexed from lo-1 on) plus the
+    // RAM IP layers produced so far, including IP{j+1}.
+    uint64_t peak = 0;
+    uint64_t ram = 0;
+    for (size_t j = 0; j < K; ++j)
+    {
+        if (j + 1 < K && plan[j] == IPPolicy::RAM)
+        {
+            ++ram;
+        }
+        const uint64_t items = MAX_LIST_SIZE * (j + 1 >= lo ? ItemIDXSizes[j] : ItemSizes[j]);
+        peak = std::max(peak, std::max(items, MAX_IP_MEM_BYTES) + ram * MAX_IP_MEM_BYTES + em_bytes);
+    }
+
+    // Expansion: recomputing IP{j} must not reach the RAM layers below it.
+    ram = 0;
+    for (size_t j = 1; j < K; ++j)
+    {
+        if (plan[j - 1] == IPPolicy::RECOMPUTE)
+        {
+            peak = std::max(peak, MAX_ITEM_MEM_BYTES + ram * MAX_IP_MEM_BYTES + em_bytes);
+        }
+        else if (plan[j - 1] == IPPolicy::RAM)
+        {
+            ++ram;
+        }
+    }
+    return peak;
+}
+
+// Indexed part of the forward pass: layer I -> I+1, recording IP{I+1} as
+// the plan says.
+template <size_t I>
+inline void plan_forward_idx(LayerIDX<I> &S, PlanContext &ctx)
+{
+    if constexpr (I + 1 == EquihashParams::K)
+    {
+        merge_inplace_for_ip<I>(S, ctx.ip_last);
+        clear_vec(S);
+    }
+    else
+    {
+        LayerIDX<I + 1> D = init_layer<ItemIDX<I + 1>>(ctx.base, MAX_LIST_SIZE * sizeof(ItemIDX<I + 1>));
+        switch (ctx.plan[I])
+        {
+        case IPPolicy::RAM:
+            merge_ip_inplace<I>(S, D, ctx.ram_ips[ctx.ram_slot[I + 1]]);
+            break;
+        case IPPolicy::SPILL:
+            ctx.manifest.ip[I].offset = ctx.writer.get_current_offset();
+            merge_em_ip_inplace<I>(S, D, ctx.writer);
+            ctx.manifest.ip[I].count = D.size();
+            break;
+        case IPPolicy::RECOMPUTE:
+        {
+            IPDiscardSink<Item_IP> discard;
+            merge_em_ip_inplace<I>(S, D, discard);
+            break;
+        }
+        }
+        set_index_batch(D);
+        clear_vec(S);
+        IFV { std::cout << "Layer " << I + 1 << " size: " << D.size() << " (" << ip_policy_char(ctx.plan[I]) << ")" << std::endl; }
+        plan_forward_idx<I + 1>(D, ctx);
+    }
+}
+
+// Non-indexed prefix: switch to indexed items at layer lowest_kept - 1.
+template <size_t I>
+inline void plan_forward(Layer<I> &S, PlanContext &ctx)
+{
+    if (I + 1 >= ctx.lowest_kept)
+    {
+        LayerIDX<I> S_IDX = expand_layer_to_idx_inplace<Item<I>, ItemIDX<I>>(S);
+        plan_forward_idx<I>(S_IDX, ctx);
+        return;
+    }
+    if constexpr (I + 2 < EquihashParams::K)
+    {
+        Layer<I + 1> D = init_layer<Item<I + 1>>(ctx.base, MAX_LIST_SIZE * sizeof(Item<I + 1>));
+        merge_inplace<I>(S, D);
+        clear_vec(S);
+        plan_forward<I + 1>(D, ctx);
+    }
+}
+
+SolutionSet cip_plan_impl(int seed, const IPPlan &plan, const std::string &em_path, uint8_t *base,
+                          const SolutionCallback *stream)
+{
+    constexpr size_t K = EquihashParams::K;
+    assert(plan.size() == K - 1 && "plan needs one entry per IP layer");
+    const size_t lo = ip_plan_lowest_kept(plan);
+    if (lo >= K)
+    {
+        return plain_cip_pr(seed, base);
+    }
+
+    const bool spill = ip_plan_has(plan, IPPolicy::SPILL);
+    const std::vector<std::string> em_files = spill ? em_split_paths(em_path, "ip_cache_" EQ_VARIANT ".bin") : std::vector<std::string>{};
+    const size_t em_bytes = spill ? em_staging_bytes<Item_IP>(g_em_direct, em_files.size()) : 0;
+    const size_t total_mem = cip_plan_peak_memory(plan, em_files.size());
+    bool own_base = false;
+    if (!base)
+    {
+        base = static_cast<uint8_t *>(std::malloc(total_mem));
+        own_base = true;
+    }
+    IFV
+    {
+        std::cout << "Total memory allocated (MB): " << total_mem / (1024 * 1024)
+                  << " (plan=" << format_ip_plan(plan) << ")" << std::endl;
+    }
+
+    uint8_t *staging = base + total_mem - em_bytes;
+    std::vector<Layer_IP> ram_ips;
+    ram_ips.reserve(K);
+    std::array<int, K> ram_slot;
+    ram_slot.fill(-1);
+    for (size_t j = 1; j < K; ++j)
+    {
+        if (plan[j - 1] == IPPolicy::RAM)
+        {
+            ram_slot[j] = static_cast<int>(ram_ips.size());
+            ram_ips.push_back(init_layer<Item_IP>(staging - (ram_ips.size() + 1) * MAX_IP_MEM_BYTES, MAX_IP_MEM_BYTES));
+        }
+    }
+    Layer_IP IPK = init_layer<Item_IP>(base, MAX_IP_MEM_BYTES);
+
+    IPDiskManifest manifest{};
+    EquihashIPDiskWriter writer;
+    if (spill)
+    {
+        writer.attach_staging(staging, em_bytes);
+        writer.set_format(g_em_format);
+        writer.set_direct(g_em_direct);
+        if (!writer.open(em_files))
+        {
+            std::cerr << "Failed to open EM file: " << em_path << std::endl;
+            if (own_base)
+            {
+                std::free(base);
+            }
+            return {};
+        }
+    }
+
+    PlanContext ctx{plan, lo, base, ram_ips, ram_slot, writer, manifest, IPK};
+    Layer0 L0 = init_layer<Item0>(base, MAX_LIST_SIZE * sizeof(Item0));
+    fill_layer0(L0, seed);
+    plan_forward<0>(L0, ctx);
+
+    if (spill)
+    {
+        manifest.blocks = writer.block_index();
+        manifest.stripes = writer.stripe_map();
+        writer.close();
+    }
+    IFV { std::cout << "Layer " << K << " IP size: " << IPK.size() << std::endl; }
+
+    SolutionSet solutions;
+    if (!IPK.empty())
+    {
+        EquihashIPDiskReader reader;
+        if (spill)
+        {
+            reader.attach_staging(staging, em_bytes);
+            reader.set_direct(g_em_direct);
+            if (!reader.open(em_files))
+            {
+                std::cerr << "Cannot open EM file for reading\n";
+                if (own_base)
+                {
+                    std::free(base);
+                }
+                return solutions;
+            }
+            reader.set_block_index(&manifest.blocks);
+            reader.set_stripe_map(&manifest.stripes);
+        }
+
+        // RAM layers below the highest recomputed one outlive its recovery;
+        // checkpoints may use the space up to them.
+        size_t ram_kept = 0;
+        for (size_t j = 1; j < K; ++j)
+        {
+            if (plan[j - 1] == IPPolicy::RAM)
+            {
+                ++ram_kept;
+            }
+            else if (plan[j - 1] == IPPolicy::RECOMPUTE)
+            {
+                ram_kept = 0;
+            }
+        }
+        PRCheckpointStack ckpt(staging - (ram_ips.size() - ram_kept) * MAX_IP_MEM_BYTES);
+
+        if (stream)
+        {
+            assert(lo == 1 && ram_ips.size() == K - 1 && "streaming needs every IP layer in RAM");
+            std::array<const Layer_IP *, K> ips;
+            ips[0] = &IPK;
+            for (size_t j = K - 1; j >= 1; --j)
+            {
+                ips[K - j] = &ram_ips[ram_slot[j]];
+            }
+            stream_solutions(seed, ips.data(), K, *stream);
+            if (own_base)
+            {
+                std::free(base);
+            }
+            return solutions;
+        }
+
+        expand_solutions(solutions, IPK);
+        for (size_t j = K - 1; j >= 1; --j)
+        {
+            switch (plan[j - 1])
+            {
+            case IPPolicy::RAM:
+                expand_solutions(solutions, ram_ips[ram_slot[j]]);
+                break;
+            case IPPolicy::SPILL:
+                expand_solutions_from_file(solutions, reader, manifest.ip[j - 1]);
+                break;
+            case IPPolicy::RECOMPUTE:
+            {
+                recover_and_expand(solutions, static_cast<int>(j), seed, base, g_pr_checkpoints ? &ckpt : nullptr);
+                break;
+            }
+            }
+        }
+        if (spill)
+        {
+            reader.close();
+        }
+    }
+
+    if (own_base)
+    {
+        std::free(base);
+    }
+    return solutions;
+}
+
+SolutionSet cip_plan(int seed, const IPPlan &plan, const std::string &em_path, uint8_t *base)
+{
+    return cip_plan_impl(seed, plan, em_path, base, nullptr);
+}
+
+// ---- CIV ----
+// Index vectors with two-run index trimming (core/civ.h); no IP layers and
+// no backward pass.
+uint64_t civ_peak_memory()
+{
+    return civ_arena_bytes();
+}
+
+SolutionSet civ(int seed, uint8_t *base, uint64_t *dropped)
+{
+    const uint64_t total_mem = civ_peak_memory();
+    bool own_base = false;
+    if (!base)
+    {
+        base = static_cast<uint8_t *>(std::malloc(total_mem));
+        own_base = true;
+    }
+    IFV
+    {
+        std::cout << "Total memory allocated (MB): " << total_mem / (1024 * 1024) << std::endl;
+    }
+
+    SolutionSet solutions = civ_solve(seed, base, total_mem, dropped);
+
+    if (own_base)
+    {
+        std::free(base);
+    }
+    return solutions;
+}
+
+// ---- Hybrid ----
+// Index vectors up to layer h1, XOR-only layers recomputed from h1+1 to h2,
+// IP layers in RAM above h2 (core/hybrid.h).
+uint64_t hybrid_peak_memory(int h1, int h2)
+{
+    return hybrid_arena_bytes(static_cast<size_t>(h1), static_cast<size_t>(h2));
+}
+
+SolutionSet hybrid(int seed, int h1, int h2, uint8_t *base)
+{
+    const uint64_t total_mem = hybrid_peak_memory(h1, h2);
+    bool own_base = false;
+    if (!base)
+    {
+        base = static_cast<uint8_t *>(std::malloc(total_mem));
+        own_base = true;
+    }
+    IFV
+    {
+        std::cout << "Total memory allocated (MB): " << total_mem / (1024 * 1024) << std::endl;
+    }
+
+    SolutionSet solutions = hybrid_solve(seed, static_cast<size_t>(h1), static_cast<size_t>(h2), base, total_mem);
+
+    if (own_base)
+    {
+        std::free(base);
+    }
+    return solutions;
+}
+
+// ---- List size reduction (LSR) ----
+// Measured baseline for the trade-off curves: plain_cip on 1/q of the
+// leaves, repeated. Run r keeps the leaves whose collision key has r in its
+// top log2(q) bits, so layer 1 is exactly the layer-1 pairs of those buckets
+// and q runs partition it. Every list is capped at MAX_LIST_SIZE / q.
+//
+// Arena: [item layers ->        <- RAM IPs], as in plain_cip.
+
+inline unsigned lsr_bits(size_t q)
+{
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < q)
+        ++bits;
+    return bits;
+}
+
+uint64_t lsr_peak_memory(size_t q)
+{
+    constexpr size_t K = EquihashParams::K;
+    const uint64_t list = MAX_LIST_SIZE / q;
+    uint64_t peak = 0;
+    // Merging layer j holds it next to IP1..IP{j+1}; IP{K} overwrites layer K-1.
+    for (size_t j = 0; j < K; ++j)
+        peak = std::max(peak, list * (ItemIDXSizes[j] + std::min(j + 1, K - 1) * sizeof(Item_IP)));
+    return peak;
+}
+
+struct LSRContext
+{
+    uint8_t *base;
+    uint8_t *end;
+    size_t list;
+    std::vector<Layer_IP> &ram_ips;
+    Layer_IP &ip_last;
+};
+
+template <size_t I>
+inline void lsr_forward(LayerIDX<I> &S, LSRContext &ctx)
+{
+    if constexpr (I + 1 == EquihashParams::K)
+    {
+        merge_inplace_for_ip<I>(S, ctx.ip_last);
+        IFV { std::cout << "Layer " << I + 1 << " IP size: " << ctx.ip_last.size() << std::endl; }
+    }
+    else
+    {
+        const uint64_t ip_bytes = ctx.list * sizeof(Item_IP);
+        ctx.ram_ips.push_back(init_layer<Item_IP>(ctx.end - (I + 1) * ip_bytes, ip_bytes));
+        LayerIDX<I + 1> D = init_layer<ItemIDX<I + 1>>(ctx.base, ctx.list * sizeof(ItemIDX<I + 1>));
+        merge_ip_inplace<I>(S, D, ctx.ram_ips.back());
+        set_index_batch(D);
+        IFV { std::cout << "Layer " << I + 1 << " size: " << D.size() << std::endl; }
+        lsr_forward<I + 1>(D, ctx);
+    }
+}
+
+SolutionSet lsr(int seed, size_t q, size_t run, uint8_t *base)
+{
+    const uint64_t total_mem = lsr_peak_memory(q);
+    bool own_base = false;
+    if (!base)
+    {
+        base = static_cast<uint8_t *>(std::malloc(total_mem));
+        own_base = true;
+    }
+    const unsigned bits = lsr_bits(q);
+    const size_t list = MAX_LIST_SIZE / q;
+    IFV
+    {
+        std::cout << "LSR run " << run << " of q=" << q << ", list size " << list
+                  << ", total memory allocated (MB): " << total_mem / (1024 * 1024) << std::endl;
+    }
+
+    LayerIDX<0> L0 = init_layer<Item0_IDX>(base, list * sizeof(Item0_IDX));
+    constexpr size_t XOR_SLICE = ItemXorSize<Item0_IDX>;
+    for_each_leaf(seed, [&](size_t leaf, const uint8_t *x)
+                  {
+                      Item0_IDX a;
+                      std::memcpy(a.XOR, x, XOR_SLICE);
+                      if (ooc_part_of(a, bits) != run || L0.size() == L0.capacity())
+                          return;
+                      set_index(a, leaf);
+                      L0.push_back(a); });
+    IFV { std::cout << "Layer 0 size: " << L0.size() << std::endl; }
+
+    std::vector<Layer_IP> ram_ips;
+    ram_ips.reserve(EquihashParams::K);
+    Layer_IP ip_last = init_layer<Item_IP>(base, list * sizeof(Item_IP));
+    LSRContext ctx{base, base + total_mem, list, ram_ips, ip_last};
+    lsr_forward<0>(L0, ctx);
+
+    SolutionSet solutions;
+    expand_solutions(solutions, ip_last);
+    for (size_t i = ram_ips.size(); i-- > 0 && !solutions.empty();)
+    {
+        expand_solutions(solutions, ram_ips[i]);
+    }
+
+    if (own_base)
+    {
+        std::free(base);
+    }
+    return solutions;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "common/apr_solvers.h"
+#include "core/pr_checkpoint.h"
+#include "core/stepper.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// ------------------ Shared solver internals ------------------
+// Helpers for src/common/apr_alg_common.cpp and the variants' apr_alg.cpp.
+
+// verbose-guarded logging helper
+#define IFV if (g_verbose)
+
+// Bytes per item of each layer below K, without and with its index.
+template <size_t... Is>
+constexpr std::array<size_t, sizeof...(Is)> layer_item_sizes(size_t index_bytes, std::index_sequence<Is...>)
+{
+    return {{(ItemXorSize<Item<Is>> + index_bytes)...}};
+}
+
+inline constexpr std::array<size_t, EquihashParams::K> ItemSizes =
+    layer_item_sizes(0, std::make_index_sequence<EquihashParams::K>{});
+inline constexpr std::array<size_t, EquihashParams::K> ItemIDXSizes =
+    layer_item_sizes(EquihashParams::kIndexBytes, std::make_index_sequence<EquihashParams::K>{});
+
+// ---- Post-retrieval ----
+// CIP-APR itself runs on CipStepper (core/stepper.h); these recover single
+// layers for cip_plan's RECOMPUTE layers. pr_front_bytes is the stepper's.
+
+// Forward pass from the non-indexed layer I up to layer h-1, checkpointing
+// the layers it passes through when there is room; `last` gets the indexed
+// layer h-1 and its number as an integral_constant.
+template <size_t I, typename Last>
+inline void recover_forward(Layer<I> &S, int h, uint8_t *base, PRCheckpointStack *ckpt, Last &&last)
+{
+    if (static_cast<int>(I) + 1 == h)
+    {
+        LayerIDX<I> S_IDX = expand_layer_to_idx_inplace<Item<I>, ItemIDX<I>>(S);
+        last(S_IDX, std::integral_constant<size_t, I>{});
+        clear_vec(S_IDX);
+        return;
+    }
+    if constexpr (I + 1 < EquihashParams::K)
+    {
+        if (ckpt && I >= 1)
+        {
+            ckpt->push(static_cast<int>(I), S.data(), S.size(), sizeof(Item<I>), base + pr_front_bytes<I>());
+        }
+        Layer<I + 1> D = init_layer<Item<I + 1>>(base, MAX_LIST_SIZE * sizeof(Item<I + 1>));
+        merge_inplace<I>(S, D);
+        clear_vec(S);
+        recover_forward<I + 1>(D, h, base, ckpt, last);
+    }
+}
+
+template <size_t I, typename Last>
+inline void recover_from_checkpoint(const PRCheckpoint &c, int h, uint8_t *base, PRCheckpointStack *ckpt, Last &&last)
+{
+    if (c.layer == static_cast<int>(I))
+    {
+        Layer<I> S = init_layer<Item<I>>(base, MAX_LIST_SIZE * sizeof(Item<I>));
+        S.resize(c.count);
+        std::memcpy(S.data(), c.data, c.count * sizeof(Item<I>));
+        recover_forward<I>(S, h, base, ckpt, last);
+        return;
+    }
+    if constexpr (I + 2 < EquihashParams::K)
+    {
+        recover_from_checkpoint<I + 1>(c, h, base, ckpt, last);
+    }
+}
+
+// Replay the forward pass up to layer h-1 (from the nearest checkpoint when
+// `ckpt` is given) and hand the indexed layer to `last`.
+template <typename Gen = LeafGenerator, typename Last>
+inline void recover_layer(int h, int seed, uint8_t *base, PRCheckpointStack *ckpt, Last &&last)
+{
+    assert(h >= 1 && h <= static_cast<int>(EquihashParams::K) && "recover_IP only supports layers 1-K");
+
+    if (const PRCheckpoint *c = ckpt ? ckpt->nearest(h) : nullptr)
+    {
+        recover_from_checkpoint<1>(*c, h, base, ckpt, last);
+        return;
+    }
+    Layer0 L0 = init_layer<Item0>(base, MAX_LIST_SIZE * sizeof(Item0));
+    fill_layer0<Gen>(L0, seed);
+    recover_forward<0>(L0, h, base, ckpt, last);
+}
+
+// Rebuild IP{h} into the front of `base`.
+template <typename Gen = LeafGenerator>
+inline Layer_IP recover_IP(int h, int seed, uint8_t *base, PRCheckpointStack *ckpt = nullptr)
+{
+    Layer_IP out_IP = init_layer<Item_IP>(base, MAX_IP_MEM_BYTES);
+    recover_layer<Gen>(h, seed, base, ckpt, [&](auto &S_IDX, auto layer)
+                       { merge_inplace_for_ip<decltype(layer)::value>(S_IDX, out_IP); });
+    return out_IP;
+}
+
+// Recover IP{h} and expand `solutions` through it. Once solutions exist only
+// the pairs they reference are kept, so no IP layer is materialized.
+inline void recover_and_expand(SolutionSet &solutions, int h, int seed, uint8_t *base,
+                               PRCheckpointStack *ckpt)
+{
+    if (!g_pr_sparse || solutions.empty())
+    {
+        Layer_IP IPh = recover_IP(h, seed, base, ckpt);
+        IFV { std::cout << "Layer " << h << " IP size: " << IPh.size() << std::endl; }
+        expand_solutions(solutions, IPh);
+        return;
+    }
+    const std::vector<size_t> wanted = solution_refs(solutions);
+    std::vector<Item_IP> pairs;
+    size_t emitted = 0;
+    recover_layer(h, seed, base, ckpt, [&](auto &S_IDX, auto layer)
+                  { emitted = merge_for_ip_sparse<decltype(layer)::value>(S_IDX, MAX_LIST_SIZE, wanted, pairs); });
+    IFV
+    {
+        std::cout << "Layer " << h << " IP pairs emitted: " << emitted << ", kept: " << pairs.size() << std::endl;
+    }
+    expand_solutions_sparse(solutions, wanted, pairs);
+}
+
+// cip_plan with `stream` (all-RAM plans only): solutions go to the callback
+// as they are expanded (core/search.h) and the returned set stays empty.
+SolutionSet cip_plan_impl(int seed, const IPPlan &plan, const std::string &em_path, uint8_t *base,
+                          const SolutionCallback *stream);
@@ -0,0 +1,1263 @@
+#include "common/apr_solvers.h"
+#include "core/civ.h"
+#include "core/hybrid.h"
+#include "core/ip_plan.h"
+#include "core/planner.h"
+#include "core/search.h"
+#include "core/stepper.h"
+#include "core/zcash_blake.h"
+
+#include <limits.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ------------------ APR driver ------------------
+// One command line for every variant: the target's apr_variant.h (via
+// common/apr_solvers.h) fixes the parameter set, EQ_VARIANT names it in the
+// summary lines and default file names.
+
+// Hex string to bytes; false on odd length or a non-hex digit.
+static bool parse_hex(const std::string &hex, std::vector<uint8_t> &out)
+{
+    if (hex.size() % 2 != 0)
+        return false;
+    out.clear();
+    for (size_t i = 0; i < hex.size(); i += 2)
+    {
+        int byte = 0;
+        for (size_t j = i; j < i + 2; ++j)
+        {
+            const char c = hex[j];
+            const int d = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (d < 0)
+                return false;
+            byte = byte * 16 + d;
+        }
+        out.push_back(static_cast<uint8_t>(byte));
+    }
+    return true;
+}
+
+static int atoi_or(const char *s, int d)
+{
+    if (!s)
+        return d;
+    try
+    {
+        return std::stoi(std::string(s));
+    }
+    catch (...)
+    {
+        return d;
+    }
+}
+
+static std::string self_exe_path()
+{
+    char buf[PATH_MAX];
+    ssize_t n = ::readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    if (n <= 0)
+        return std::string("apr_" EQ_VARIANT);
+    buf[n] = 0;
+    return std::string(buf);
+}
+
+// Run `args` as a fresh process and return its exit status. With `out`, the
+// child's stdout is also collected there (and still echoed).
+static int run_isolated_child(const std::vector<std::string> &args, std::string *out = nullptr)
+{
+    std::vector<char *> cargs;
+    cargs.reserve(args.size() + 1);
+    for (auto &s : args)
+        cargs.push_back(const_cast<char *>(s.c_str()));
+    cargs.push_back(nullptr);
+
+    int fds[2] = {-1, -1};
+    if (out && pipe(fds) < 0)
+    {
+        perror("pipe");
+        return 1;
+    }
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0)
+    {
+        if (out)
+        {
+            dup2(fds[1], STDOUT_FILENO);
+            close(fds[0]);
+            close(fds[1]);
+        }
+        std::vector<char *> envp;
+        envp.push_back(nullptr);
+        execve(args[0].c_str(), cargs.data(), envp.data());
+        perror("execve");
+        _exit(127);
+    }
+
+    if (out)
+    {
+        close(fds[1]);
+        out->clear();
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(fds[0], buf, sizeof(buf))) > 0 || (n < 0 && errno == EINTR))
+        {
+            if (n > 0)
+            {
+                out->append(buf, static_cast<size_t>(n));
+                std::cout.write(buf, n);
+            }
+        }
+        close(fds[0]);
+        std::cout.flush();
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0)
+    {
+        perror("waitpid");
+        return 1;
+    }
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    return 1;
+}
+
+static inline double now_s()
+{
+    using clock = std::chrono::steady_clock;
+    return std::chrono::duration<double>(clock::now().time_since_epoch()).count();
+}
+
+static int run_mode_cip(int seed, int iters, bool do_check, bool verbose,
+                        const std::string &sort_name)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(MAX_CIP_BYTES));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (MAX_CIP_BYTES / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, MAX_CIP_BYTES);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const int current_seed = seed + it;
+        auto t0 = now_s();
+        SolutionSet solutions = plain_cip(current_seed, base);
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            check_zero_xor(current_seed, solutions);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+        }
+        total_sols += solutions.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=cip variant=" EQ_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " peakRSS_kB=" << peak_kb
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+static int run_mode_pr(int seed, int iters, bool do_check, bool verbose,
+                       const std::string &sort_name)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    const uint64_t total_mem = plain_cip_pr_peak_memory();
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const int current_seed = seed + it;
+        auto t0 = now_s();
+        SolutionSet solutions = plain_cip_pr(current_seed, base);
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            check_zero_xor(current_seed, solutions);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+        }
+        total_sols += solutions.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=cip-pr variant=" EQ_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " peakRSS_kB=" << peak_kb
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+static int run_mode_em(int seed, int iters, bool do_check, bool verbose,
+                       const std::string &sort_name, const std::string &em_path)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    const uint64_t total_mem = MAX_ITEM_MEM_BYTES + em_staging_bytes<Item_IP>(g_em_direct, em_path_count(em_path));
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const int current_seed = seed + it;
+        auto t0 = now_s();
+        SolutionSet solutions = cip_em(current_seed, em_path, base);
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            check_zero_xor(current_seed, solutions);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+        }
+        total_sols += solutions.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=cip-em variant=" EQ_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " peakRSS_kB=" << peak_kb
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+static int run_mode_ooc(int seed, int iters, bool do_check, bool verbose,
+                        const std::string &sort_name, const std::string &em_path, size_t mem_budget)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    const uint64_t total_mem = cip_ooc_peak_memory(mem_budget, em_path_count(em_path));
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0;
+    uint64_t total_dropped = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const int current_seed = seed + it;
+        uint64_t dropped = 0;
+        auto t0 = now_s();
+        SolutionSet solutions = cip_ooc(current_seed, em_path, mem_budget, base, &dropped);
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+        total_dropped += dropped;
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            check_zero_xor(current_seed, solutions);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+        }
+        total_sols += solutions.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=cip-ooc variant=" EQ_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " peakRSS_kB=" << peak_kb
+              << " dropped=" << total_dropped
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+static int run_mode_plan(int seed, int iters, bool do_check, bool verbose,
+                         const std::string &sort_name, const std::string &em_path, const IPPlan &plan)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    const uint64_t total_mem = cip_plan_peak_memory(plan, em_path_count(em_path));
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const int current_seed = seed + it;
+        auto t0 = now_s();
+        SolutionSet solutions = cip_plan(current_seed, plan, em_path, base);
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            check_zero_xor(current_seed, solutions);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+        }
+        total_sols += solutions.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=cip-plan variant=" EQ_VARIANT " plan=" << format_ip_plan(plan) << " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " peakRSS_kB=" << peak_kb
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+static int run_mode_cip_apr(int seed, int iters, bool do_check, bool verbose,
+                            const std::string &sort_name, int h)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    size_t total_mem = advanced_cip_pr_peak_memory(h);
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const int current_seed = seed + it;
+        auto t0 = now_s();
+        SolutionSet solutions = run_advanced_cip_pr(current_seed, h, base);
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            check_zero_xor(current_seed, solutions);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+        }
+        total_sols += solutions.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=cip-apr variant=" EQ_VARIANT " h=" << h << " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " peakRSS_kB=" << peak_kb
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+static int run_mode_civ(int seed, int iters, bool do_check, bool verbose,
+                        const std::string &sort_name)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    const uint64_t total_mem = civ_peak_memory();
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0;
+    uint64_t total_dropped = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const int current_seed = seed + it;
+        uint64_t dropped = 0;
+        auto t0 = now_s();
+        SolutionSet solutions = civ(current_seed, base, &dropped);
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+        total_dropped += dropped;
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            check_zero_xor(current_seed, solutions);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+        }
+        total_sols += solutions.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=civ variant=" EQ_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " trim_bits=" << CIV_TRIM_BITS
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " arena_MB=" << (total_mem >> 20)
+              << " peakRSS_kB=" << peak_kb
+              << " dropped=" << total_dropped
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+static int run_mode_lsr(int seed, int iters, bool do_check, bool verbose,
+                        const std::string &sort_name, size_t q, size_t runs)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    const uint64_t total_mem = lsr_peak_memory(q);
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const int current_seed = seed + it;
+        for (size_t run = 0; run < runs; ++run)
+        {
+            auto t0 = now_s();
+            SolutionSet solutions = lsr(current_seed, q, run, base);
+            auto t1 = now_s();
+            t_fwd_exp_sum += (t1 - t0);
+
+            if (do_check)
+            {
+                auto t2 = now_s();
+                check_zero_xor(current_seed, solutions);
+                auto t3 = now_s();
+                t_verify_sum += (t3 - t2);
+            }
+            total_sols += solutions.size();
+        }
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=lsr variant=" EQ_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " q=" << q << " runs=" << runs
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " arena_MB=" << (total_mem >> 20)
+              << " peakRSS_kB=" << peak_kb
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+static int run_mode_hybrid(int seed, int iters, bool do_check, bool verbose,
+                           const std::string &sort_name, int h1, int h2)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    const uint64_t total_mem = hybrid_peak_memory(h1, h2);
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const int current_seed = seed + it;
+        auto t0 = now_s();
+        SolutionSet solutions = hybrid(current_seed, h1, h2, base);
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            check_zero_xor(current_seed, solutions);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+        }
+        total_sols += solutions.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=hybrid variant=" EQ_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " h1=" << h1 << " h2=" << h2
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " arena_MB=" << (total_mem >> 20)
+              << " peakRSS_kB=" << peak_kb
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+// Try nonces seed, seed+1, ... (at most `iters`) until `target` valid
+// solutions are found. Solutions are streamed out of the expansion as they
+// are verified; a nonce is abandoned after `per_nonce` of them (0: all).
+static int run_mode_search(int seed, int iters, bool verbose, const std::string &sort_name,
+                           size_t target, size_t per_nonce)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    const uint64_t total_mem = MAX_CIP_BYTES;
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    size_t found = 0;
+    int tried = 0;
+    double t_first = 0.0;
+    const double t_start = now_s();
+    for (int it = 0; it < iters && found < target; ++it, ++tried)
+    {
+        const int current_seed = seed + it;
+        size_t in_nonce = 0;
+        cip_search(current_seed, base, [&](const uint32_t *indices, size_t width)
+                   {
+                       const double t = now_s() - t_start;
+                       if (found == 0)
+                           t_first = t;
+                       ++found;
+                       ++in_nonce;
+                       std::cout << std::fixed << std::setprecision(2) << "found nonce=" << current_seed
+                                 << " width=" << width << " first_index=" << indices[0] << " t=" << t << std::endl;
+                       return found < target && (per_nonce == 0 || in_nonce < per_nonce);
+                   });
+    }
+    const double t_total = now_s() - t_start;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=search variant=" EQ_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " target=" << target << " per_nonce=" << per_nonce
+              << " nonces=" << tried << " seed_range=" << seed << "-" << (seed + std::max(tried, 1) - 1)
+              << " first_sol_time=" << t_first
+              << " total_time=" << t_total
+              << " peakRSS_kB=" << peak_rss_kb()
+              << " total_sols=" << found
+              << " Sol/s=" << (t_total > 0.0 ? static_cast<double>(found) / t_total : 0.0) << std::endl;
+
+    std::free(base);
+    return found >= target ? 0 : 2;
+}
+
+// CIP-APR through the preemptible stepper (core/stepper.h). With
+// preempt_ms > 0 each solve is abandoned at the first layer boundary after
+// that many milliseconds, as on a new block header; the delay between the
+// deadline and the stop is the cancel latency.
+static int run_mode_preempt(int seed, int iters, bool do_check, bool verbose,
+                            const std::string &sort_name, int h, int preempt_ms)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    const uint64_t total_mem = advanced_cip_pr_peak_memory(h);
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0, max_step = 0.0, max_cancel = 0.0;
+    size_t total_sols = 0, steps = 0;
+    int cancelled = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const int current_seed = seed + it;
+        auto t0 = now_s();
+        CipStepper solver(current_seed, h, base, total_mem, g_pr_checkpoints, g_pr_sparse);
+        bool stale = false;
+        while (!solver.done())
+        {
+            const double t = now_s();
+            if (preempt_ms > 0 && t - t0 >= preempt_ms / 1000.0)
+            {
+                max_cancel = std::max(max_cancel, t - t0 - preempt_ms / 1000.0);
+                stale = true;
+                break;
+            }
+            solver.step();
+            max_step = std::max(max_step, now_s() - t);
+        }
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+        steps += solver.steps();
+        if (stale)
+        {
+            ++cancelled;
+            continue;
+        }
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            check_zero_xor(current_seed, solver.solutions());
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+        }
+        total_sols += solver.solutions().size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=preempt variant=" EQ_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " h=" << h << " preempt_ms=" << preempt_ms
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " cancelled=" << cancelled << " steps=" << steps
+              << " max_step_time=" << max_step << " max_cancel_latency=" << max_cancel
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " arena_MB=" << (total_mem >> 20)
+              << " peakRSS_kB=" << peak_kb
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+// ---- Planner ----
+// Candidates of --mode=auto and --mode=calibrate under `budget`: plain CIP,
+// CIP-APR at every switching height (h = K-1 is CIP-PR), CIP-EM, CIP-OOC
+// with its partitions sized to the budget, CIV, the hybrid at every pair of
+// heights and LSR at q = 2..16. cip-ooc and civ report what they drop; lsr
+// only finds the solutions whose leaves share a 1/q slice, so it is the
+// fallback when nothing else fits.
+static std::vector<PlanCandidate> plan_candidates(const std::string &em_path, uint64_t budget)
+{
+    constexpr int K = static_cast<int>(EquihashParams::K);
+    const size_t stripes = em_path_count(em_path);
+    std::vector<PlanCandidate> cands;
+    cands.push_back({"cip", 0, MAX_CIP_BYTES});
+    for (int h = 1; h < K; ++h)
+        cands.push_back({"cip-apr", h, advanced_cip_pr_peak_memory(h)});
+    cands.push_back({"cip-em", 0, MAX_ITEM_MEM_BYTES + em_staging_bytes<Item_IP>(g_em_direct, stripes)});
+    cands.push_back({"cip-ooc", 0, cip_ooc_peak_memory(budget, stripes), 0, budget});
+    cands.push_back({"civ", 0, civ_peak_memory()});
+    for (int h1 = 0; h1 < K - 1; ++h1)
+        for (int h2 = h1 + 1; h2 < K; ++h2)
+            cands.push_back({"hybrid", h1, hybrid_peak_memory(h1, h2), h2});
+    for (size_t q = 2; q <= 16 && q <= (size_t(1) << EquihashParams::kCollisionBitLength); q *= 2)
+        cands.push_back({"lsr", static_cast<int>(q), lsr_peak_memory(q), 0, 0, true});
+    return cands;
+}
+
+static SolutionSet plan_solve(const PlanCandidate &c, int seed, const std::string &em_path, uint8_t *base,
+                              uint64_t *dropped)
+{
+    if (c.mode == "cip")
+        return plain_cip(seed, base);
+    if (c.mode == "cip-em")
+        return cip_em(seed, em_path, base);
+    if (c.mode == "cip-ooc")
+        return cip_ooc(seed, em_path, c.ooc_bytes, base, dropped);
+    if (c.mode == "civ")
+        return civ(seed, base, dropped);
+    if (c.mode == "hybrid")
+        return hybrid(seed, c.h, c.h2, base);
+    if (c.mode == "lsr")
+    {
+        // Every run of the seed, one 1/q slice of the leaves each
+        const size_t q = static_cast<size_t>(c.h);
+        SolutionSet all;
+        for (size_t run = 0; run < q; ++run)
+        {
+            const SolutionSet part = lsr(seed, q, run, base);
+            for (size_t s = 0; s < part.size(); ++s)
+                all.push_full(part[s]);
+        }
+        return all;
+    }
+    return run_advanced_cip_pr(seed, c.h, base);
+}
+
+// Time one solve of every candidate that fits the budget and save the
+// profile --mode=auto plans with.
+static int run_mode_calibrate(int seed, bool verbose, const std::string &sort_name,
+                              const std::string &em_path, uint64_t budget_cli, const std::string &profile_path)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    const uint64_t budget = plan_budget_bytes(budget_cli);
+    CalibrationProfile profile;
+    profile.load(profile_path);
+    for (const PlanCandidate &c : plan_candidates(em_path, budget))
+    {
+        if (c.peak_bytes > budget)
+            continue;
+        uint8_t *base = static_cast<uint8_t *>(std::malloc(c.peak_bytes));
+        if (!base)
+            continue;
+        std::memset(base, 0, c.peak_bytes);
+        auto t0 = now_s();
+        SolutionSet solutions = plan_solve(c, seed, em_path, base, nullptr);
+        auto t1 = now_s();
+        std::free(base);
+        profile.seconds[c.label()] = t1 - t0;
+        std::cout << std::fixed << std::setprecision(2) << "calibrate " << c.label()
+                  << " arena_MB=" << (c.peak_bytes >> 20) << " time=" << (t1 - t0)
+                  << " sols=" << solutions.size() << std::endl;
+    }
+    if (!profile.save(profile_path, EQ_VARIANT))
+    {
+        std::cerr << "Cannot write calibration profile " << profile_path << std::endl;
+        return 1;
+    }
+    std::cout << "Calibration profile written to " << profile_path << std::endl;
+    return 0;
+}
+
+static int run_mode_auto(int seed, int iters, bool do_check, bool verbose, const std::string &sort_name,
+                         const std::string &em_path, uint64_t budget_cli, const std::string &profile_path)
+{
+    g_verbose = verbose;
+    g_sort_algo = (sort_name == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    CalibrationProfile profile;
+    if (!profile.load(profile_path))
+    {
+        std::cout << "No calibration profile at " << profile_path
+                  << ", planning by arena size (run --mode=calibrate)" << std::endl;
+    }
+
+    uint8_t *base = nullptr;
+    PlanCandidate current;
+    int replans = 0;
+    uint64_t budget = 0;
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0;
+    uint64_t total_dropped = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        std::string source;
+        budget = plan_budget_bytes(budget_cli, &source);
+        // cip-ooc is sized to the budget, so the candidates follow it
+        const std::vector<PlanCandidate> cands = plan_candidates(em_path, budget);
+        const int pick = choose_plan(cands, budget, profile);
+        if (pick < 0)
+        {
+            std::cerr << "No configuration fits the " << (budget >> 20) << " MB budget (" << source << ")" << std::endl;
+            std::free(base);
+            return 1;
+        }
+        const PlanCandidate &c = cands[pick];
+        if (c.label() != current.label() || c.peak_bytes != current.peak_bytes || c.ooc_bytes != current.ooc_bytes)
+        {
+            std::free(base);
+            base = static_cast<uint8_t *>(std::malloc(c.peak_bytes));
+            if (!base)
+            {
+                std::cerr << "Failed to allocate " << (c.peak_bytes / (1024 * 1024))
+                          << " MB of memory" << std::endl;
+                return 1;
+            }
+            std::memset(base, 0, c.peak_bytes);
+            replans += !current.mode.empty();
+            current = c;
+            std::cout << "plan=" << c.label() << " arena_MB=" << (c.peak_bytes >> 20)
+                      << " budget_MB=" << (budget >> 20) << " (" << source << ")" << std::endl;
+        }
+
+        const int current_seed = seed + it;
+        uint64_t dropped = 0;
+        auto t0 = now_s();
+        SolutionSet solutions = plan_solve(current, current_seed, em_path, base, &dropped);
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+        total_dropped += dropped;
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            check_zero_xor(current_seed, solutions);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+        }
+        total_sols += solutions.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=auto variant=" EQ_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx")
+              << " plan=" << (current.mode.empty() ? std::string("none") : current.label())
+              << " replans=" << replans << " budget_MB=" << (budget >> 20)
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " peakRSS_kB=" << peak_kb
+              << " dropped=" << total_dropped
+              << " total_sols=" << total_sols << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+// total_sols=N from a summary line, -1 if there is none.
+static long long parse_total_sols(const std::string &out)
+{
+    const std::string tag = " total_sols=";
+    const size_t at = out.rfind(tag);
+    if (at == std::string::npos)
+        return -1;
+    return std::strtoll(out.c_str() + at + tag.size(), nullptr, 10);
+}
+
+// Every mode over the same seeds, each in its own process. A mode fails the
+// test by exiting non-zero or by finding a different number of solutions
+// than cip. search runs unbounded (all solutions of every nonce) and lsr
+// with q = 1, where both cover exactly what cip does.
+static int run_test_harness(int seed, int iters, bool do_check,
+                            const std::string &sortopt, const std::string &em_path)
+{
+    const std::string exe = self_exe_path();
+    std::vector<std::vector<std::string>> runs = {
+        {"--mode=cip"},
+        {"--mode=cip-pr"},
+        {"--mode=cip-em", "--em=" + em_path},
+        {"--mode=cip-ooc", "--em=" + em_path},
+        {"--mode=cip-plan", "--em=" + em_path},
+        {"--mode=civ"},
+        {"--mode=hybrid"},
+        {"--mode=lsr", "--lsr-q=1"},
+        {"--mode=search", "--target=" + std::to_string(INT_MAX), "--per-nonce=0"},
+        {"--mode=preempt"},
+    };
+    // cip-apr at every switching height
+    for (int h = 0; h < static_cast<int>(EquihashParams::K); ++h)
+        runs.push_back({"--mode=cip-apr", "--h=" + std::to_string(h)});
+
+    long long expected = -1;
+    for (const auto &extra : runs)
+    {
+        std::vector<std::string> args;
+        args.push_back(exe);
+        args.insert(args.end(), extra.begin(), extra.end());
+        args.push_back(std::string("--seed=") + std::to_string(seed));
+        args.push_back(std::string("--iters=") + std::to_string(iters));
+        args.push_back(std::string("--sort=") + sortopt);
+        if (do_check)
+            args.push_back("--check");
+        std::string out;
+        int rc = run_isolated_child(args, &out);
+        if (rc == 2 && extra[0] == "--mode=search")
+            rc = 0; // short of --target, which an unbounded search always is
+        if (rc != 0)
+            return rc;
+        const long long sols = parse_total_sols(out);
+        if (expected < 0)
+            expected = sols; // cip runs first
+        if (sols < 0 || sols != expected)
+        {
+            std::cerr << "Test failed: " << extra[0] << " found " << sols << " solution(s), cip found "
+                      << expected << " (seeds " << seed << "-" << seed + iters - 1 << ")" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int seed = 0;
+    int iters = 1;
+    bool do_check = true;
+    bool verbose = false;
+    bool run_test = false;
+    std::string mode = "cip";
+    std::string sortopt = "kx";
+    std::string em_path = "ip_cache_" EQ_VARIANT ".bin";
+    int h = 3; // Default switching height
+    int h1 = 1; // Hybrid switching heights
+    int h2 = static_cast<int>(EquihashParams::K) / 2 + 1;
+    size_t lsr_q = 2; // LSR list reduction factor
+    size_t lsr_runs = 0; // 0: q runs
+    std::string header_hex; // 108-byte block header, empty: seed instances
+    std::string nonce_hex;
+    int preempt_ms = 0; // preempt: abandon each solve after this long, 0 = never
+    size_t target = 1; // search: valid solutions to find
+    size_t per_nonce = 1; // search: solutions taken per nonce, 0 = all
+    uint64_t budget_mb = 0; // 0: cgroup memory.max or physical memory
+    std::string profile_path = "apr_profile_" EQ_VARIANT ".txt";
+    size_t ooc_mem_mb = 0;
+    std::string plan_str;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--seed=", 0) == 0)
+            seed = atoi_or(arg.c_str() + 7, seed);
+        else if (arg.rfind("--iters=", 0) == 0)
+            iters = atoi_or(arg.c_str() + 8, iters);
+        else if (arg.rfind("--mode=", 0) == 0)
+            mode = arg.substr(7);
+        else if (arg.rfind("--sort=", 0) == 0)
+            sortopt = arg.substr(7);
+        else if (arg.rfind("--em=", 0) == 0)
+            em_path = arg.substr(5);
+        else if (arg.rfind("--em-format=", 0) == 0)
+        {
+            const std::string fmt = arg.substr(12);
+            if (fmt == "raw")
+                g_em_format = IPDiskFormat::RAW;
+            else if (fmt == "packed")
+                g_em_format = IPDiskFormat::PACKED;
+            else
+            {
+                std::cerr << "Unknown em-format: " << fmt << " (expected raw or packed)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--em-direct")
+            g_em_direct = true;
+        else if (arg.rfind("--ooc-mem=", 0) == 0)
+            ooc_mem_mb = static_cast<size_t>(atoi_or(arg.c_str() + 10, 0));
+        else if (arg == "--no-pr-ckpt")
+            g_pr_checkpoints = false;
+        else if (arg == "--pr-dense")
+            g_pr_sparse = false;
+        else if (arg.rfind("--pr-ckpt-mem=", 0) == 0)
+            g_pr_ckpt_bytes = static_cast<uint64_t>(atoi_or(arg.c_str() + 14, 0)) << 20;
+        else if (arg.rfind("--verify-threads=", 0) == 0)
+            g_verify_threads = static_cast<unsigned>(atoi_or(arg.c_str() + 17, 0));
+        else if (arg.rfind("--plan=", 0) == 0)
+            plan_str = arg.substr(7);
+        else if (arg.rfind("--h=", 0) == 0)
+            h = atoi_or(arg.c_str() + 4, h);
+        else if (arg.rfind("--h1=", 0) == 0)
+            h1 = atoi_or(arg.c_str() + 5, h1);
+        else if (arg.rfind("--h2=", 0) == 0)
+            h2 = atoi_or(arg.c_str() + 5, h2);
+        else if (arg.rfind("--header=", 0) == 0)
+            header_hex = arg.substr(9);
+        else if (arg.rfind("--nonce=", 0) == 0)
+            nonce_hex = arg.substr(8);
+        else if (arg.rfind("--preempt-ms=", 0) == 0)
+            preempt_ms = atoi_or(arg.c_str() + 13, 0);
+        else if (arg.rfind("--target=", 0) == 0)
+            target = static_cast<size_t>(std::max(1, atoi_or(arg.c_str() + 9, 1)));
+        else if (arg.rfind("--per-nonce=", 0) == 0)
+            per_nonce = static_cast<size_t>(std::max(0, atoi_or(arg.c_str() + 12, 1)));
+        else if (arg.rfind("--budget=", 0) == 0)
+            budget_mb = static_cast<uint64_t>(atoi_or(arg.c_str() + 9, 0));
+        else if (arg.rfind("--profile=", 0) == 0)
+            profile_path = arg.substr(10);
+        else if (arg.rfind("--lsr-q=", 0) == 0)
+            lsr_q = static_cast<size_t>(atoi_or(arg.c_str() + 8, 0));
+        else if (arg.rfind("--lsr-runs=", 0) == 0)
+            lsr_runs = static_cast<size_t>(atoi_or(arg.c_str() + 11, 0));
+        else if (arg == "--verbose")
+            verbose = true;
+        else if (arg == "--test")
+            run_test = true;
+        else if (arg == "-h" || arg == "--help")
+        {
+            std::cout << "Usage: " << argv[0]
+                      << " [--mode=cip|cip-pr|cip-em|cip-ooc|cip-apr|cip-plan|civ|hybrid|lsr|auto|calibrate|search|preempt] [--seed=N] [--iters=M]"
+                         " [--sort=std|kx] [--em=path] [--em-format=raw|packed] [--em-direct] [--ooc-mem=MB] [--plan=m|d|r...] [--no-pr-ckpt] [--pr-dense] [--pr-ckpt-mem=MB] [--verify-threads=N] [--h=0-"
+                      << EquihashParams::K - 1
+                      << "] [--h1=N] [--h2=N] [--lsr-q=Q] [--lsr-runs=R] [--budget=MB] [--profile=path] [--target=N] [--per-nonce=M] [--preempt-ms=T] [--header=hex] [--nonce=hex] [--verbose] [--test]\n"
+                         "  --em=path[,path...]: External memory file(s) or directories; several entries stripe the IP layers (default: ip_cache_" EQ_VARIANT ".bin)\n"
+                         "  --em-format=raw|packed: On-disk IP layer layout for cip-em (default: raw)\n"
+                         "  --em-direct: Bypass the page cache (O_DIRECT) for the cip-em file\n"
+                         "  --ooc-mem=MB: RAM budget for cip-ooc, which also keeps item layers on disk (default: 16 partitions)\n"
+                         "  --plan=STR: cip-plan placement of IP1..IP{K-1}, one letter per layer: m = RAM, d = disk (--em), r = recompute (default: from --h)\n"
+                         "  --no-pr-ckpt: Recover every IP layer from layer 0 instead of from checkpoints\n"
+                         "  --pr-dense: Rebuild whole IP layers during post-retrieval instead of only the referenced pairs\n"
+                         "  --pr-ckpt-mem=MB: Extra arena for cip-pr recovery checkpoints (default: 0, free space only)\n"
+                         "  --verify-threads=N: Threads for --check (default: 0, one per core)\n"
+                         "  --h=N: Switching height for cip-apr and preempt, 0 <= N <= "
+                      << EquihashParams::K - 1 << " (default: 3)\n"
+                         "  --mode=civ: Carry index vectors with two-run index trimming, keeping "
+                      << CIV_TRIM_BITS << " bit(s) per index in the first run (-DCIV_TRIM_BITS)\n"
+                         "  --mode=hybrid: Index vectors up to layer h1, recomputed XOR-only layers up to h2, IP layers in RAM above\n"
+                         "  --h1=N, --h2=N: Switching heights for hybrid, 0 <= h1 < h2 <= K-1 (default: 1, K/2+1)\n"
+                         "  --mode=lsr: List size reduction baseline, plain cip over 1/q of the leaves per run\n"
+                         "  --lsr-q=Q: LSR reduction factor, a power of two (default: 2)\n"
+                         "  --lsr-runs=R: LSR runs per seed, each over a different 1/q of the leaves, at most q (default: q)\n"
+                         "  --mode=auto: Run the fastest of cip, cip-apr (any h), cip-em, cip-ooc, civ, hybrid (any h1, h2) that fits the memory budget (lsr with q = 2..16 if none does), re-planned before every solve\n"
+                         "  --mode=calibrate: Time one solve of every configuration that fits the budget and save the profile auto plans with\n"
+                         "  --budget=MB: Arena budget for auto and calibrate (default: cgroup memory.max, else physical memory, less "
+                      << PLAN_HEADROOM_MB << " MB)\n"
+                         "  --profile=path: Calibration profile (default: apr_profile_" EQ_VARIANT ".txt)\n"
+                         "  --mode=search: Try nonces seed.. (at most --iters) under cip, streaming each solution as soon as it is verified\n"
+                         "  --target=N: Stop the search after N valid solutions (default: 1)\n"
+                         "  --per-nonce=M: Move to the next nonce after M solutions, 0 for all (default: 1)\n"
+                         "  --mode=preempt: cip-apr at --h as resumable steps (one merge or expansion layer each)\n"
+                         "  --preempt-ms=T: Abandon each preempt solve at the first step boundary after T ms, 0 for never (default: 0)\n"
+                         "  --header=hex: Solve a 108-byte block header instead of the seed instances; seed s is the nonce\n"
+                         "                whose LE64 counter at byte 24 is --nonce's plus s (block 0 compressed once)\n"
+                         "  --nonce=hex: First 32-byte nonce for --header (default: zero)\n";
+            return 0;
+        }
+    }
+
+    static ZcashHeaderPrefix header_prefix;
+    if (!header_hex.empty())
+    {
+        std::vector<uint8_t> header, nonce(ZcashHeaderPrefix::NONCE_LEN, 0);
+        if (!parse_hex(header_hex, header) || (!nonce_hex.empty() && !parse_hex(nonce_hex, nonce)) ||
+            nonce.size() != ZcashHeaderPrefix::NONCE_LEN || !header_prefix.init(header.data(), header.size(), nonce.data()))
+        {
+            std::cerr << "--header must be " << ZcashHeaderPrefix::HEADER_LEN << " bytes and --nonce "
+                      << ZcashHeaderPrefix::NONCE_LEN << " bytes of hex" << std::endl;
+            return 1;
+        }
+        g_header = &header_prefix;
+    }
+
+    if (run_test)
+        return run_test_harness(seed, iters, do_check, sortopt, em_path);
+
+    if (mode == "cip")
+        return run_mode_cip(seed, iters, do_check, verbose, sortopt);
+    if (mode == "cip-pr")
+        return run_mode_pr(seed, iters, do_check, verbose, sortopt);
+    if (mode == "cip-em")
+        return run_mode_em(seed, iters, do_check, verbose, sortopt, em_path);
+    if (mode == "cip-ooc")
+        return run_mode_ooc(seed, iters, do_check, verbose, sortopt, em_path, ooc_mem_mb << 20);
+    if (mode == "cip-plan")
+    {
+        const size_t layers = EquihashParams::K - 1;
+        IPPlan plan = ip_plan_for_switching_height(h, layers);
+        if (!plan_str.empty() && !parse_ip_plan(plan_str, layers, plan))
+        {
+            std::cerr << "--plan needs " << layers << " letters from m, d, r" << std::endl;
+            return 1;
+        }
+        return run_mode_plan(seed, iters, do_check, verbose, sortopt, em_path, plan);
+    }
+    if (mode == "cip-apr")
+        return run_mode_cip_apr(seed, iters, do_check, verbose, sortopt, h);
+    if (mode == "civ")
+        return run_mode_civ(seed, iters, do_check, verbose, sortopt);
+    if (mode == "preempt")
+        return run_mode_preempt(seed, iters, do_check, verbose, sortopt, h, preempt_ms);
+    if (mode == "search")
+        return run_mode_search(seed, iters, verbose, sortopt, target, per_nonce);
+    if (mode == "auto")
+        return run_mode_auto(seed, iters, do_check, verbose, sortopt, em_path, budget_mb << 20, profile_path);
+    if (mode == "calibrate")
+        return run_mode_calibrate(seed, verbose, sortopt, em_path, budget_mb << 20, profile_path);
+    if (mode == "lsr")
+    {
+        if (lsr_runs == 0)
+            lsr_runs = lsr_q;
+        if (lsr_q == 0 || (lsr_q & (lsr_q - 1)) != 0 || lsr_q > (size_t(1) << EquihashParams::kCollisionBitLength) ||
+            lsr_runs > lsr_q)
+        {
+            std::cerr << "lsr needs a power-of-two --lsr-q up to 2^" << EquihashParams::kCollisionBitLength
+                      << " and at most q runs" << std::endl;
+            return 1;
+        }
+        return run_mode_lsr(seed, iters, do_check, verbose, sortopt, lsr_q, lsr_runs);
+    }
+    if (mode == "hybrid")
+    {
+        if (h1 < 0 || h1 >= h2 || h2 > static_cast<int>(EquihashParams::K) - 1)
+        {
+            std::cerr << "hybrid needs 0 <= h1 < h2 <= " << EquihashParams::K - 1 << std::endl;
+            return 1;
+        }
+        return run_mode_hybrid(seed, iters, do_check, verbose, sortopt, h1, h2);
+    }
+
+    std::cerr << "Unknown mode: " << mode << std::endl;
+    return 1;
+}
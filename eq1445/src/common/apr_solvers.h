@@ -0,0 +1,52 @@
+#pragma once
+
+#include "apr_variant.h"
+#include "core/ip_plan.h"
+#include "core/search.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// ------------------ APR solver entry points ------------------
+// Every variant links the shared driver (src/common/apr_main.cpp) and the
+// shared solvers (src/common/apr_alg_common.cpp) against its own
+// apr_alg.cpp, which provides the modes it unrolls by hand (plain_cip,
+// cip_search, cip_em) and the arena of CIP-APR at each switching height.
+
+// Defined by the variant's apr_alg.cpp
+SolutionSet plain_cip(int seed, uint8_t *base = nullptr);
+size_t cip_search(int seed, uint8_t *base, const SolutionCallback &cb);
+SolutionSet cip_em(int seed, const std::string &em_path, uint8_t *base = nullptr);
+uint64_t advanced_cip_pr_peak_memory(int h);
+
+// Defined by src/common/apr_alg_common.cpp
+SolutionSet run_advanced_cip_pr(int seed, int h, uint8_t *base = nullptr);
+SolutionSet plain_cip_pr(int seed, uint8_t *base = nullptr);
+uint64_t plain_cip_pr_peak_memory();
+// `dropped` receives the items that did not fit their partition's work area.
+SolutionSet cip_ooc(int seed, const std::string &em_path, size_t mem_budget, uint8_t *base = nullptr,
+                    uint64_t *dropped = nullptr);
+uint64_t cip_ooc_peak_memory(size_t mem_budget, size_t stripes);
+SolutionSet cip_plan(int seed, const IPPlan &plan, const std::string &em_path, uint8_t *base = nullptr);
+uint64_t cip_plan_peak_memory(const IPPlan &plan, size_t stripes);
+SolutionSet civ(int seed, uint8_t *base = nullptr, uint64_t *dropped = nullptr);
+uint64_t civ_peak_memory();
+SolutionSet hybrid(int seed, int h1, int h2, uint8_t *base = nullptr);
+uint64_t hybrid_peak_memory(int h1, int h2);
+SolutionSet lsr(int seed, size_t q, size_t run, uint8_t *base = nullptr);
+uint64_t lsr_peak_memory(size_t q);
+
+extern SortAlgo g_sort_algo;
+extern bool g_verbose;
+extern IPDiskFormat g_em_format;
+extern bool g_em_direct;
+extern bool g_pr_checkpoints;
+extern uint64_t g_pr_ckpt_bytes;
+extern bool g_pr_sparse;
+extern unsigned g_verify_threads;
+extern uint64_t MAX_ITEM_MEM_BYTES;
+extern uint64_t MAX_IP_MEM_BYTES;
+
+// plain_cip: the item layers plus IP1..IP{K-1}
+const inline uint64_t MAX_CIP_BYTES = MAX_ITEM_MEM_BYTES + MAX_IP_MEM_BYTES * (EquihashParams::K - 1);
@@ -0,0 +1,11 @@
+#pragma once
+
+// Equihash (144,5) for the shared APR driver and solvers in src/common,
+// which include this header by name; the apr_144_5 target puts src/eq144_5
+// on its include path.
+#include "eq144_5/equihash_144_5.h"
+#include "eq144_5/merge_144_5.h"
+#include "eq144_5/sort_144_5.h"
+#include "eq144_5/util_144_5.h"
+
+#define EQ_VARIANT "144_5"
@@ -0,0 +1,11 @@
+#pragma once
+
+// Equihash (200,9) for the shared APR driver and solvers in src/common,
+// which include this header by name; the apr_200_9 and apr_x41 targets put
+// src/eq200_9 on their include path.
+#include "eq200_9/equihash_200_9.h"
+#include "eq200_9/merge_200_9.h"
+#include "eq200_9/sort_200_9.h"
+#include "eq200_9/util_200_9.h"
+
+#define EQ_VARIANT "200_9"
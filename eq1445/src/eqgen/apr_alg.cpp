@@ -0,0 +1,49 @@
+#include "common/apr_alg_common.h"
+#include "core/ip_plan.h"
+#include "core/search.h"
+
+#include <string>
+
+// ---- Fixed placements ----
+// The hand-written 200_9 and 144_5 solvers unroll each mode layer by layer.
+// Here every mode is the per-layer plan it corresponds to, run by cip_plan:
+// plain_cip keeps all IP layers in RAM (m...m) and cip_em spills them
+// (d...d). CIP-APR at h (r^h m^(K-1-h)) runs on the shared stepper in the
+// arena cip_plan would use for that plan.
+
+static IPPlan uniform_plan(IPPolicy p)
+{
+    return IPPlan(EquihashParams::K - 1, p);
+}
+
+uint64_t plain_cip_peak_memory()
+{
+    return cip_plan_peak_memory(uniform_plan(IPPolicy::RAM), 0);
+}
+
+SolutionSet plain_cip(int seed, uint8_t *base)
+{
+    return cip_plan(seed, uniform_plan(IPPolicy::RAM), std::string(), base);
+}
+
+size_t cip_search(int seed, uint8_t *base, const SolutionCallback &cb)
+{
+    size_t streamed = 0;
+    const SolutionCallback counted = [&](const uint32_t *indices, size_t width)
+    {
+        ++streamed;
+        return cb(indices, width);
+    };
+    cip_plan_impl(seed, uniform_plan(IPPolicy::RAM), std::string(), base, &counted);
+    return streamed;
+}
+
+SolutionSet cip_em(int seed, const std::string &em_path, uint8_t *base)
+{
+    return cip_plan(seed, uniform_plan(IPPolicy::SPILL), em_path, base);
+}
+
+uint64_t advanced_cip_pr_peak_memory(int h)
+{
+    return cip_plan_peak_memory(ip_plan_for_switching_height(h, EquihashParams::K - 1), 0);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// Equihash (EQ_N, EQ_K) for the shared APR driver and solvers in src/common,
+// which include this header by name; the apr_<N>_<K> targets put src/eqgen
+// on their include path. equihash_gen.h defines EQ_VARIANT.
+#include "eqgen/equihash_gen.h"
+#include "eqgen/merge_gen.h"
+#include "eqgen/sort_gen.h"
+#include "eqgen/util_gen.h"
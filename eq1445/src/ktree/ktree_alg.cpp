@@ -0,0 +1,176 @@
+#include "ktree/ktree.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// ------------------ Global Variables ------------------
+SortAlgo g_sort_algo = SortAlgo::KXSORT;
+bool g_verbose = false;
+
+// ------------------ Run description ------------------
+// A run builds the whole tree once. Full and first trimmed runs use every
+// index of every list; a second trimmed run only the indices of list i
+// that are congruent to fixed[i] modulo 2^trim_bits, stored in full.
+struct KTreeRun
+{
+    const KTreeHasher *hasher = nullptr;
+    uint8_t *arena_end = nullptr;
+    size_t max_list = 0;
+    size_t trim_bits = 0;            // 0: full indices
+    const uint32_t *fixed = nullptr; // second trimmed run only
+};
+
+template <size_t IB>
+static KTreeLayer<IB, 0> ktree_make_list(const KTreeRun &run, size_t list, uint8_t *at)
+{
+    auto L = init_layer<KTreeItem<IB, 0>>(at, static_cast<size_t>(run.arena_end - at));
+    const size_t first = run.fixed ? run.fixed[list] : 0;
+    const size_t step = run.fixed ? size_t(1) << run.trim_bits : 1;
+    const size_t mask = (run.fixed || run.trim_bits == 0) ? ~size_t(0) : (size_t(1) << run.trim_bits) - 1;
+    for (size_t j = first; j < KTreeParams::kListSize; j += step)
+    {
+        KTreeItem<IB, 0> item;
+        run.hasher->item(list, j, item.XOR);
+        set_index(item, j & mask);
+        L.push_back(item);
+    }
+    return L;
+}
+
+// Subtree of depth D over lists [first, first + 2^D), built at `at`.
+template <size_t IB, size_t D>
+static KTreeLayer<IB, D> ktree_build(const KTreeRun &run, size_t first, uint8_t *at)
+{
+    if constexpr (D == 0)
+    {
+        return ktree_make_list<IB>(run, first, at);
+    }
+    else
+    {
+        auto left = ktree_build<IB, D - 1>(run, first, at);
+        auto right = ktree_build<IB, D - 1>(run, first + (size_t(1) << (D - 1)),
+                                            reinterpret_cast<uint8_t *>(left.data() + left.size()));
+        auto dst = init_layer<KTreeItem<IB, D>>(at, static_cast<size_t>(run.arena_end - at));
+        merge_two_lists_inplace_generic<KTreeItem<IB, D - 1>, KTreeItem<IB, D>,
+                                        ktree_merge_item<IB, D - 1>, ktree_sort<IB, D - 1>,
+                                        typename KTreeStep<D - 1>::Key, ktree_key<IB, D - 1>>(
+            left, right, dst, run.max_list);
+        if (g_verbose)
+        {
+            std::cout << "Merge two lists at depth " << D - 1 << ", the length of merged list: "
+                      << dst.size() << std::endl;
+        }
+        return dst;
+    }
+}
+
+// Whole tree; returns the index vectors of the root.
+template <size_t IB>
+static std::vector<uint32_t> ktree_run(const KTreeRun &run, uint8_t *base)
+{
+    constexpr size_t D = KTreeParams::LGK - 1;
+    auto left = ktree_build<IB, D>(run, 0, base);
+    auto right = ktree_build<IB, D>(run, KTreeParams::kLists / 2,
+                                    reinterpret_cast<uint8_t *>(left.data() + left.size()));
+    auto root = init_layer<KTreeIndexVec<IB>>(base, static_cast<size_t>(run.arena_end - base));
+    merge_two_lists_inplace_generic<KTreeItem<IB, D>, KTreeIndexVec<IB>,
+                                    ktree_root_item<IB>, ktree_sort<IB, D>,
+                                    typename KTreeStep<D>::Key, ktree_key<IB, D>>(
+        left, right, root, run.max_list);
+    if (g_verbose)
+    {
+        std::cout << "Merge two lists at depth " << D << ", the length of merged list: "
+                  << root.size() << std::endl;
+    }
+
+    std::vector<uint32_t> out;
+    out.reserve(root.size() * KTreeParams::kLists);
+    for (const auto &r : root)
+        for (size_t i = 0; i < KTreeParams::kLists; ++i)
+            out.push_back(ktree_get_index<IB>(r.index + i * IB));
+    return out;
+}
+
+uint64_t ktree_iv_peak_memory()
+{
+    return ktree_arena_bytes<KTreeParams::kIndexBytes>(KTreeParams::kMaxListSize);
+}
+
+// The first run holds trimmed index vectors; the second full ones, but
+// for lists 2^trim_bits times shorter.
+uint64_t ktree_trim_peak_memory(size_t trim_bits)
+{
+    return std::max(ktree_arena_bytes<KTreeParams::kTrimIndexBytes>(KTreeParams::kMaxListSize),
+                    ktree_arena_bytes<KTreeParams::kIndexBytes>(KTreeParams::kMaxListSize >> trim_bits));
+}
+
+// Index-vector solver: full indices travel with the items.
+KTreeSolutions ktree_iv(const KTreeHasher &hasher, uint8_t *base, uint64_t arena_bytes)
+{
+    KTreeRun run;
+    run.hasher = &hasher;
+    run.arena_end = base + arena_bytes;
+    run.max_list = KTreeParams::kMaxListSize;
+    KTreeSolutions sols;
+    sols.idx = ktree_run<KTreeParams::kIndexBytes>(run, base);
+    return sols;
+}
+
+// Index trimming: a first run keeps the low `trim_bits` bits of every
+// index; each distinct trimmed vector it finds is completed by a second run
+// over only the matching indices of every list.
+KTreeSolutions ktree_trim(const KTreeHasher &hasher, size_t trim_bits, uint8_t *base, uint64_t arena_bytes)
+{
+    KTreeRun run;
+    run.hasher = &hasher;
+    run.arena_end = base + arena_bytes;
+    run.max_list = KTreeParams::kMaxListSize;
+    run.trim_bits = trim_bits;
+    std::vector<uint32_t> flat = ktree_run<KTreeParams::kTrimIndexBytes>(run, base);
+
+    std::vector<std::vector<uint32_t>> candidates;
+    for (size_t s = 0; s < flat.size(); s += KTreeParams::kLists)
+        candidates.emplace_back(flat.begin() + s, flat.begin() + s + KTreeParams::kLists);
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    if (g_verbose)
+    {
+        std::cout << "Second run with trimmed index bit length " << trim_bits << " for "
+                  << candidates.size() << " candidate(s)" << std::endl;
+    }
+
+    KTreeSolutions sols;
+    run.max_list = KTreeParams::kMaxListSize >> trim_bits;
+    for (const auto &cand : candidates)
+    {
+        run.fixed = cand.data();
+        std::vector<uint32_t> found = ktree_run<KTreeParams::kIndexBytes>(run, base);
+        sols.idx.insert(sols.idx.end(), found.begin(), found.end());
+    }
+    return sols;
+}
+
+// Number of solutions whose items XOR to zero.
+size_t ktree_verify(const KTreeHasher &hasher, const KTreeSolutions &sols)
+{
+    size_t valid = 0;
+    uint8_t acc[KTreeParams::kHashBytes], x[KTreeParams::kHashBytes];
+    for (size_t s = 0; s < sols.size(); ++s)
+    {
+        const uint32_t *sol = sols[s];
+        std::memset(acc, 0, sizeof(acc));
+        bool ok = true;
+        for (size_t i = 0; i < KTreeParams::kLists && ok; ++i)
+        {
+            ok = sol[i] < KTreeParams::kListSize;
+            hasher.item(i, sol[i], x);
+            for (size_t t = 0; t < sizeof(acc); ++t)
+                acc[t] ^= x[t];
+        }
+        for (size_t t = 0; t < sizeof(acc) && ok; ++t)
+            ok = acc[t] == 0;
+        valid += ok;
+    }
+    return valid;
+}
@@ -0,0 +1,209 @@
+#include "ktree/ktree.h"
+#include "core/mem_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Forward declarations from ktree/ktree_alg.cpp
+uint64_t ktree_iv_peak_memory();
+uint64_t ktree_trim_peak_memory(size_t trim_bits);
+KTreeSolutions ktree_iv(const KTreeHasher &hasher, uint8_t *base, uint64_t arena_bytes);
+KTreeSolutions ktree_trim(const KTreeHasher &hasher, size_t trim_bits, uint8_t *base, uint64_t arena_bytes);
+size_t ktree_verify(const KTreeHasher &hasher, const KTreeSolutions &sols);
+
+extern SortAlgo g_sort_algo;
+extern bool g_verbose;
+
+static int atoi_or(const char *s, int d)
+{
+    if (!s)
+        return d;
+    try
+    {
+        return std::stoi(std::string(s));
+    }
+    catch (...)
+    {
+        return d;
+    }
+}
+
+static inline double now_s()
+{
+    using clock = std::chrono::steady_clock;
+    return std::chrono::duration<double>(clock::now().time_since_epoch()).count();
+}
+
+static bool parse_nonce(const std::string &hex, uint8_t (&out)[KTreeParams::kNonceBytes])
+{
+    if (hex.size() != 2 * KTreeParams::kNonceBytes)
+        return false;
+    for (size_t i = 0; i < KTreeParams::kNonceBytes; ++i)
+    {
+        char *end = nullptr;
+        const std::string byte = hex.substr(2 * i, 2);
+        const long v = std::strtol(byte.c_str(), &end, 16);
+        if (!end || *end)
+            return false;
+        out[i] = static_cast<uint8_t>(v);
+    }
+    return true;
+}
+
+// Nonce of iteration `seed`: the --nonce value if given, otherwise the seed
+// little-endian in the first four bytes.
+static KTreeHasher make_hasher(int seed, bool fixed_nonce, const uint8_t (&nonce)[KTreeParams::kNonceBytes])
+{
+    KTreeHasher h;
+    std::memcpy(h.nonce, nonce, sizeof(h.nonce));
+    if (!fixed_nonce)
+    {
+        std::memset(h.nonce, 0, sizeof(h.nonce));
+        for (int i = 0; i < 4; ++i)
+            h.nonce[i] = static_cast<uint8_t>((static_cast<uint32_t>(seed) >> (8 * i)) & 0xFF);
+    }
+    return h;
+}
+
+static int run_mode(const std::string &mode, size_t trim_bits, int seed, int iters, bool do_check,
+                    bool fixed_nonce, const uint8_t (&nonce)[KTreeParams::kNonceBytes])
+{
+    const bool trim = mode == "trim";
+    const uint64_t total_mem = trim ? ktree_trim_peak_memory(trim_bits) : ktree_iv_peak_memory();
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_solve_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0, total_valid = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const KTreeHasher hasher = make_hasher(seed + it, fixed_nonce, nonce);
+        auto t0 = now_s();
+        KTreeSolutions sols = trim ? ktree_trim(hasher, trim_bits, base, total_mem)
+                                   : ktree_iv(hasher, base, total_mem);
+        auto t1 = now_s();
+        t_solve_sum += (t1 - t0);
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            const size_t valid = ktree_verify(hasher, sols);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+            total_valid += valid;
+            if (g_verbose)
+            {
+                std::cout << "Solutions: " << sols.size() << ", correct: " << valid << std::endl;
+            }
+        }
+        total_sols += sols.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_solve = t_solve_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_solve_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_solve_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=" << mode
+              << " variant=ktree_" KT_VARIANT " sort="
+              << (g_sort_algo == SortAlgo::STD ? "std" : "kx");
+    if (trim)
+        std::cout << " trim_bits=" << trim_bits;
+    std::cout << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_solve
+              << " verify_time=" << avg_ver
+              << " arena_MB=" << (total_mem >> 20)
+              << " peakRSS_kB=" << peak_kb
+              << " total_sols=" << total_sols;
+    if (do_check)
+        std::cout << " valid_sols=" << total_valid;
+    std::cout << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int seed = 0;
+    int iters = 1;
+    bool do_check = true;
+    std::string mode = "iv";
+    std::string sortopt = "kx";
+    const size_t max_trim = std::min<size_t>(8 * KTreeParams::kTrimIndexBytes, KTreeParams::kEll - 1);
+    size_t trim_bits = max_trim;
+    bool fixed_nonce = false;
+    uint8_t nonce[KTreeParams::kNonceBytes] = {};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--seed=", 0) == 0)
+            seed = atoi_or(arg.c_str() + 7, seed);
+        else if (arg.rfind("--iters=", 0) == 0)
+            iters = atoi_or(arg.c_str() + 8, iters);
+        else if (arg.rfind("--mode=", 0) == 0)
+            mode = arg.substr(7);
+        else if (arg.rfind("--sort=", 0) == 0)
+            sortopt = arg.substr(7);
+        else if (arg.rfind("--trim=", 0) == 0)
+            trim_bits = static_cast<size_t>(atoi_or(arg.c_str() + 7, 0));
+        else if (arg.rfind("--nonce=", 0) == 0)
+        {
+            if (!parse_nonce(arg.substr(8), nonce))
+            {
+                std::cerr << "--nonce needs " << 2 * KTreeParams::kNonceBytes << " hex digits" << std::endl;
+                return 1;
+            }
+            fixed_nonce = true;
+        }
+        else if (arg == "--no-check")
+            do_check = false;
+        else if (arg == "--verbose")
+            g_verbose = true;
+        else if (arg == "-h" || arg == "--help")
+        {
+            std::cout << "Usage: " << argv[0]
+                      << " [--mode=iv|trim] [--trim=BITS] [--seed=N] [--iters=M] [--nonce=HEX] [--sort=std|kx] [--no-check] [--verbose]\n"
+                         "  Strict generalized birthday problem, n=" KT_STR(KT_N) " over 2^" KT_STR(KT_LGK) " lists\n"
+                         "  --mode=iv: Carry full index vectors through the tree (default)\n"
+                         "  --mode=trim: Carry trimmed indices, then rerun on the matching indices per candidate\n"
+                         "  --trim=BITS: Index bits kept by the first trimmed run (default: "
+                      << max_trim << ", at most " << max_trim << ")\n"
+                         "  --nonce=HEX: 16-byte nonce used for every iteration (default: seed, little-endian)\n"
+                         "  --no-check: Skip solution verification\n";
+            return 0;
+        }
+    }
+
+    g_sort_algo = (sortopt == "std") ? SortAlgo::STD : SortAlgo::KXSORT;
+
+    if (mode == "iv")
+        return run_mode(mode, 0, seed, iters, do_check, fixed_nonce, nonce);
+    if (mode == "trim")
+    {
+        if (trim_bits < 1 || trim_bits > max_trim)
+        {
+            std::cerr << "--trim must be between 1 and " << max_trim << std::endl;
+            return 1;
+        }
+        return run_mode(mode, trim_bits, seed, iters, do_check, fixed_nonce, nonce);
+    }
+
+    std::cerr << "Unknown mode: " << mode << std::endl;
+    return 1;
+}
@@ -0,0 +1,128 @@
+#include "wagner/wagner.h"
+#include "rt/rt_context.h"
+
+#include <exception>
+#include <new>
+#include <string>
+
+struct wagner_ctx
+{
+    RtSolverContext solver;
+};
+
+static int wagner_error_code(RtStatus status)
+{
+    switch (status)
+    {
+    case RtStatus::OK:
+        return 0;
+    case RtStatus::BAD_PARAMS:
+        return WAGNER_ERR_PARAMS;
+    case RtStatus::BAD_MODE:
+        return WAGNER_ERR_MODE;
+    case RtStatus::OVER_BUDGET:
+        return WAGNER_ERR_BUDGET;
+    case RtStatus::NO_MEMORY:
+        return WAGNER_ERR_NOMEM;
+    }
+    return WAGNER_ERR_MODE;
+}
+
+static bool wagner_rt_mode(wagner_mode mode, RtMode &out)
+{
+    switch (mode)
+    {
+    case WAGNER_MODE_AUTO:
+        out = RtMode::AUTO;
+        return true;
+    case WAGNER_MODE_CIP:
+        out = RtMode::CIP;
+        return true;
+    case WAGNER_MODE_CIP_PR:
+        out = RtMode::CIP_PR;
+        return true;
+    }
+    return false;
+}
+
+extern "C" {
+
+wagner_ctx *wagner_ctx_create(void)
+{
+    return new (std::nothrow) wagner_ctx();
+}
+
+void wagner_ctx_destroy(wagner_ctx *ctx)
+{
+    delete ctx;
+}
+
+int wagner_solve(wagner_ctx *ctx, const uint8_t *header, size_t header_len,
+                 const uint8_t nonce[32], wagner_params params, wagner_mode mode,
+                 uint64_t budget, wagner_solution_cb cb, void *user)
+{
+    if (!ctx || !nonce)
+        return WAGNER_ERR_ARG;
+    RtMode rt_mode;
+    if (!wagner_rt_mode(mode, rt_mode))
+        return WAGNER_ERR_MODE;
+
+    // No exception may cross the C boundary: the solver's vectors and
+    // strings allocate outside the arena.
+    try
+    {
+        size_t delivered = 0;
+        const RtStatus status = ctx->solver.solve(
+            params.n, params.k, header, header_len, nonce, rt_mode, budget,
+            [&](const uint32_t *indices, size_t count)
+            { return !cb || cb(indices, count, user) == 0; },
+            delivered);
+        if (status != RtStatus::OK)
+            return wagner_error_code(status);
+        return static_cast<int>(delivered);
+    }
+    catch (const std::bad_alloc &)
+    {
+        ctx->solver.set_error("out of memory");
+        return WAGNER_ERR_NOMEM;
+    }
+    catch (const std::exception &e)
+    {
+        ctx->solver.set_error(e.what());
+        return WAGNER_ERR_INTERNAL;
+    }
+    catch (...)
+    {
+        ctx->solver.set_error("unknown exception");
+        return WAGNER_ERR_INTERNAL;
+    }
+}
+
+uint64_t wagner_peak_memory(wagner_params params, wagner_mode mode)
+{
+    try
+    {
+        RtParams p;
+        std::string err;
+        RtMode rt_mode;
+        if (!rt_params_init(params.n, params.k, p, err) || !wagner_rt_mode(mode, rt_mode))
+            return 0;
+        return rt_peak_memory(p, rt_mode);
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+uint64_t wagner_ctx_arena_bytes(const wagner_ctx *ctx)
+{
+    return ctx ? ctx->solver.arena_bytes() : 0;
+}
+
+const char *wagner_last_error(const wagner_ctx *ctx)
+{
+    return ctx ? ctx->solver.error().c_str() : "null context";
+}
+
+} // extern "C"
@@ -0,0 +1,152 @@
+#include "core/mem_stats.h"
+#include "rt/rt_params.h"
+#include "rt/rt_solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+static int atoi_or(const char *s, int d)
+{
+    if (!s)
+        return d;
+    try
+    {
+        return std::stoi(std::string(s));
+    }
+    catch (...)
+    {
+        return d;
+    }
+}
+
+static inline double now_s()
+{
+    using clock = std::chrono::steady_clock;
+    return std::chrono::duration<double>(clock::now().time_since_epoch()).count();
+}
+
+static int run_mode(const RtParams &p, const std::string &mode, int seed, int iters, bool do_check,
+                    bool verbose)
+{
+    const bool pr = mode == "cip-pr";
+    const uint64_t total_mem = pr ? rt_cip_pr_peak_memory(p) : rt_cip_peak_memory(p);
+    uint8_t *base = static_cast<uint8_t *>(std::malloc(total_mem));
+    if (!base)
+    {
+        std::cerr << "Failed to allocate " << (total_mem / (1024 * 1024))
+                  << " MB of memory" << std::endl;
+        return 1;
+    }
+    std::memset(base, 0, total_mem);
+
+    double t_fwd_exp_sum = 0.0, t_verify_sum = 0.0;
+    size_t total_sols = 0, total_valid = 0;
+
+    for (int it = 0; it < iters; ++it)
+    {
+        const uint32_t current_seed = static_cast<uint32_t>(seed + it);
+        RtHasher H;
+        H.init_seed(p, current_seed);
+        auto t0 = now_s();
+        SolutionSet solutions = pr ? rt_cip_pr(p, H, base, verbose) : rt_cip(p, H, base, verbose);
+        auto t1 = now_s();
+        t_fwd_exp_sum += (t1 - t0);
+
+        if (do_check)
+        {
+            auto t2 = now_s();
+            const size_t valid = rt_verify(p, H, solutions);
+            auto t3 = now_s();
+            t_verify_sum += (t3 - t2);
+            total_valid += valid;
+            std::cout << "seed=" << current_seed << " solutions=" << solutions.size()
+                      << " valid=" << valid << std::endl;
+        }
+        total_sols += solutions.size();
+    }
+
+    long peak_kb = peak_rss_kb();
+    double avg_fwd = t_fwd_exp_sum / std::max(1, iters);
+    double avg_ver = t_verify_sum / std::max(1, iters);
+    double sols_per_s = (t_fwd_exp_sum > 0.0)
+                            ? (static_cast<double>(total_sols) / t_fwd_exp_sum)
+                            : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2) << "mode=" << mode
+              << " variant=rt_" << p.n << "_" << p.k
+              << " iters=" << iters << " seed_range=" << seed << "-" << (seed + iters - 1)
+              << " single_run_time=" << avg_fwd
+              << " verify_time=" << avg_ver
+              << " arena_MB=" << (total_mem >> 20)
+              << " peakRSS_kB=" << peak_kb
+              << " total_sols=" << total_sols;
+    if (do_check)
+        std::cout << " valid_sols=" << total_valid;
+    std::cout << " Sol/s=" << sols_per_s << std::endl;
+
+    std::free(base);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int n = 200;
+    int k = 9;
+    int seed = 0;
+    int iters = 1;
+    bool do_check = true;
+    bool verbose = false;
+    std::string mode = "cip";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--n=", 0) == 0)
+            n = atoi_or(arg.c_str() + 4, n);
+        else if (arg.rfind("--k=", 0) == 0)
+            k = atoi_or(arg.c_str() + 4, k);
+        else if (arg.rfind("--seed=", 0) == 0)
+            seed = atoi_or(arg.c_str() + 7, seed);
+        else if (arg.rfind("--iters=", 0) == 0)
+            iters = atoi_or(arg.c_str() + 8, iters);
+        else if (arg.rfind("--mode=", 0) == 0)
+            mode = arg.substr(7);
+        else if (arg == "--no-check")
+            do_check = false;
+        else if (arg == "--verbose")
+            verbose = true;
+        else if (arg == "-h" || arg == "--help")
+        {
+            std::cout << "Usage: " << argv[0]
+                      << " [--n=N] [--k=K] [--mode=cip|cip-pr] [--seed=N] [--iters=M] [--no-check] [--verbose]\n"
+                         "  --n=N, --k=K: Equihash parameters, chosen at run time (default: 200, 9)\n"
+                         "  --mode=cip|cip-pr: Keep IP1..IP{K-1} in RAM, or recompute them from layer 0 (default: cip)\n"
+                         "  --no-check: Skip solution verification\n";
+            return 0;
+        }
+    }
+
+    if (n <= 0 || k <= 0)
+    {
+        std::cerr << "--n and --k must be positive" << std::endl;
+        return 1;
+    }
+    RtParams p;
+    std::string err;
+    if (!rt_params_init(static_cast<uint32_t>(n), static_cast<uint32_t>(k), p, err))
+    {
+        std::cerr << "Unsupported (n, k) = (" << n << ", " << k << "): " << err << std::endl;
+        return 1;
+    }
+
+    if (mode == "cip" || mode == "cip-pr")
+        return run_mode(p, mode, seed, iters, do_check, verbose);
+
+    std::cerr << "Unknown mode: " << mode << std::endl;
+    return 1;
+}